@@ -0,0 +1,265 @@
+#include <vector>
+#include <string>
+#include <set>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <stdint.h>
+
+#include "alphabet.hpp"
+#include "common.hpp"
+
+static Alphabet global_alphabet;
+
+Alphabet::Alphabet() {
+    byte_to_letter.fill(NOT_A_LETTER);
+    for (char character = 'a'; character <= 'z' && letters.size() < ALPHABET_LENGTH; character++) {
+        _add_letter(std::string(1, character));
+    }
+}
+
+Alphabet Alphabet::from_words(const std::vector<std::string>& words) {
+    Alphabet alphabet;
+
+    // std::string compares bytewise, which for UTF-8 is code point order
+    std::set<std::string> extra_characters;
+    std::vector<std::string> characters;
+    for (const auto& word : words) {
+        if (!split_characters(to_lower_case(word), characters)) {
+            continue;
+        }
+        for (const auto& character : characters) {
+            uletter_int letter;
+            if (!alphabet._find_letter(character, letter)) {
+                extra_characters.insert(character);
+            }
+        }
+    }
+
+    for (const auto& character : extra_characters) {
+        if (alphabet.letters.size() == ALPHABET_LENGTH) {
+            break;
+        }
+        alphabet._add_letter(character);
+    }
+    return alphabet;
+}
+
+uletter_int Alphabet::size() const {
+    return (uletter_int) letters.size();
+}
+
+std::string Alphabet::get_letter_string(uletter_int letter) const {
+    if (letter >= letters.size()) {
+        return "[" + std::to_string(letter) + "]";  // room the lists didn't need
+    }
+    return letters[letter];
+}
+
+bool Alphabet::to_word(const std::string& word, WordArray& dest) const {
+    std::vector<std::string> characters;
+    if (!split_characters(to_lower_case(word), characters) || characters.size() != WORD_LENGTH) {
+        return false;
+    }
+    for (uletter_int index = 0; index < WORD_LENGTH; index++) {
+        if (!_find_letter(characters[index], dest[index])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string Alphabet::to_string(const WordArray& word) const {
+    std::string word_string;
+    for (auto letter : word) {
+        word_string += get_letter_string(letter);
+    }
+    return word_string;
+}
+
+void Alphabet::_add_letter(const std::string& character) {
+    uletter_int letter = (uletter_int) letters.size();
+    letters.push_back(character);
+    if (character.size() == 1) {
+        byte_to_letter[(unsigned char) character[0]] = letter;
+    } else {
+        multibyte_to_letter[character] = letter;
+    }
+}
+
+bool Alphabet::_find_letter(const std::string& character, uletter_int& letter_dest) const {
+    if (character.size() == 1) {
+        int16_t letter = byte_to_letter[(unsigned char) character[0]];
+        if (letter == NOT_A_LETTER) {
+            return false;
+        }
+        letter_dest = (uletter_int) letter;
+        return true;
+    }
+    auto found = multibyte_to_letter.find(character);
+    if (found == multibyte_to_letter.end()) {
+        return false;
+    }
+    letter_dest = found->second;
+    return true;
+}
+
+bool split_characters(const std::string& word, std::vector<std::string>& characters_dest) {
+    characters_dest.clear();
+    std::size_t index = 0;
+    while (index < word.size()) {
+        unsigned char lead = word[index];
+        std::size_t length;
+        if (lead < 0x80) {
+            length = 1;
+        } else if ((lead & 0xe0) == 0xc0) {
+            length = 2;
+        } else if ((lead & 0xf0) == 0xe0) {
+            length = 3;
+        } else if ((lead & 0xf8) == 0xf0) {
+            length = 4;
+        } else {
+            return false;
+        }
+        if (index + length > word.size()) {
+            return false;
+        }
+        for (std::size_t continuation = index + 1; continuation < index + length; continuation++) {
+            if (((unsigned char) word[continuation] & 0xc0) != 0x80) {
+                return false;
+            }
+        }
+        characters_dest.push_back(word.substr(index, length));
+        index += length;
+    }
+    return true;
+}
+
+// Inclusive ranges of code points that are letters, in order
+static constexpr std::pair<uint32_t, uint32_t> LETTER_RANGES[] = {
+    {'a', 'z'},
+    {0x00c0, 0x00d6}, {0x00d8, 0x00f6}, {0x00f8, 0x02af},  // Latin-1, Extended-A/B, IPA
+    {0x0386, 0x0386}, {0x0388, 0x038a}, {0x038c, 0x038c},  // Greek
+    {0x038e, 0x03a1}, {0x03a3, 0x03f5}, {0x03f7, 0x03ff},
+    {0x0400, 0x0481}, {0x048a, 0x052f},                    // Cyrillic
+    {0x0531, 0x0556}, {0x0561, 0x0587},                    // Armenian
+    {0x05d0, 0x05ea},                                      // Hebrew
+    {0x0620, 0x064a}, {0x0671, 0x06d3},                    // Arabic
+    {0x10d0, 0x10ff},                                      // Georgian
+    {0x1e00, 0x1eff},                                      // Latin Extended Additional
+    {0x1f00, 0x1fbc}, {0x1fc2, 0x1fcc}, {0x1fd0, 0x1fdb},  // Greek Extended
+    {0x1fe0, 0x1fec}, {0x1ff2, 0x1ffc},
+    {0x3041, 0x3096}, {0x30a1, 0x30fa},                    // Hiragana, Katakana
+    {0xac00, 0xd7a3},                                      // Hangul syllables
+};
+
+// Capital letters: every step-th code point from first to last is one, and
+// its lowercase is offset away. In order.
+struct CaseRange {
+    uint32_t first;
+    uint32_t last;
+    int32_t offset;
+    uint32_t step;
+};
+
+static constexpr CaseRange CAPITAL_RANGES[] = {
+    {'A', 'Z', 0x20, 1},
+    {0x00c0, 0x00d6, 0x20, 1}, {0x00d8, 0x00de, 0x20, 1},      // Latin-1
+    {0x0100, 0x012f, 1, 2}, {0x0130, 0x0130, 'i' - 0x0130, 1},  // Latin Extended-A
+    {0x0132, 0x0137, 1, 2}, {0x0139, 0x0148, 1, 2}, {0x014a, 0x0177, 1, 2},
+    {0x0178, 0x0178, 0x00ff - 0x0178, 1}, {0x0179, 0x017e, 1, 2},
+    {0x01cd, 0x01dc, 1, 2}, {0x01de, 0x01ef, 1, 2},             // Latin Extended-B
+    {0x01f8, 0x021f, 1, 2}, {0x0222, 0x0233, 1, 2}, {0x0246, 0x024f, 1, 2},
+    {0x0386, 0x0386, 0x26, 1}, {0x0388, 0x038a, 0x25, 1},       // Greek
+    {0x038c, 0x038c, 0x40, 1}, {0x038e, 0x038f, 0x3f, 1},
+    {0x0391, 0x03a1, 0x20, 1}, {0x03a3, 0x03ab, 0x20, 1}, {0x03d8, 0x03ef, 1, 2},
+    {0x0400, 0x040f, 0x50, 1}, {0x0410, 0x042f, 0x20, 1},       // Cyrillic
+    {0x0460, 0x0481, 1, 2}, {0x048a, 0x04bf, 1, 2}, {0x04c0, 0x04c0, 0x0f, 1},
+    {0x04c1, 0x04ce, 1, 2}, {0x04d0, 0x052f, 1, 2},
+    {0x0531, 0x0556, 0x30, 1},                                  // Armenian
+    {0x1e00, 0x1e95, 1, 2}, {0x1e9e, 0x1e9e, 0x00df - 0x1e9e, 1},  // Latin Extended Additional
+    {0x1ea0, 0x1eff, 1, 2},
+    {0x1f08, 0x1f0f, -8, 1}, {0x1f18, 0x1f1d, -8, 1},           // Greek Extended
+    {0x1f28, 0x1f2f, -8, 1}, {0x1f38, 0x1f3f, -8, 1}, {0x1f48, 0x1f4d, -8, 1},
+    {0x1f59, 0x1f5f, -8, 2}, {0x1f68, 0x1f6f, -8, 1},
+};
+
+// One of split_characters's characters as a code point. split_characters
+// already checked the continuation bytes, so this just takes 6 bits from each.
+static uint32_t decode_character(const std::string& character) {
+    static constexpr unsigned char LEAD_MASKS[] = {0x7f, 0x1f, 0x0f, 0x07};
+    uint32_t code_point = (unsigned char) character[0] & LEAD_MASKS[std::min<std::size_t>(character.size(), 4) - 1];
+    for (std::size_t index = 1; index < character.size(); index++) {
+        code_point = (code_point << 6) | ((unsigned char) character[index] & 0x3f);
+    }
+    return code_point;
+}
+
+static std::string encode_code_point(uint32_t code_point) {
+    std::string character;
+    if (code_point < 0x80) {
+        character += (char) code_point;
+    } else if (code_point < 0x800) {
+        character += (char) (0xc0 | (code_point >> 6));
+        character += (char) (0x80 | (code_point & 0x3f));
+    } else if (code_point < 0x10000) {
+        character += (char) (0xe0 | (code_point >> 12));
+        character += (char) (0x80 | ((code_point >> 6) & 0x3f));
+        character += (char) (0x80 | (code_point & 0x3f));
+    } else {
+        character += (char) (0xf0 | (code_point >> 18));
+        character += (char) (0x80 | ((code_point >> 12) & 0x3f));
+        character += (char) (0x80 | ((code_point >> 6) & 0x3f));
+        character += (char) (0x80 | (code_point & 0x3f));
+    }
+    return character;
+}
+
+static uint32_t to_lower_code_point(uint32_t code_point) {
+    for (const auto& range : CAPITAL_RANGES) {
+        if (code_point < range.first) {
+            break;
+        }
+        if (code_point <= range.last && (code_point - range.first) % range.step == 0) {
+            return code_point + range.offset;
+        }
+    }
+    return code_point;
+}
+
+std::string to_lower_case(const std::string& word) {
+    std::vector<std::string> characters;
+    if (!split_characters(word, characters)) {
+        return word;
+    }
+    std::string lower_word;
+    lower_word.reserve(word.size());
+    for (const auto& character : characters) {
+        lower_word += encode_code_point(to_lower_code_point(decode_character(character)));
+    }
+    return lower_word;
+}
+
+bool is_letter_character(const std::string& character) {
+    if (character.empty()) {
+        return false;
+    }
+    const uint32_t code_point = decode_character(character);
+    for (const auto& [first, last] : LETTER_RANGES) {
+        if (code_point < first) {
+            return false;
+        }
+        if (code_point <= last) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void set_alphabet(const Alphabet& alphabet) {
+    global_alphabet = alphabet;
+}
+
+const Alphabet& get_alphabet() {
+    return global_alphabet;
+}
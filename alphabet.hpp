@@ -0,0 +1,66 @@
+#ifndef alphabet_hpp
+#define alphabet_hpp
+
+#include <vector>
+#include <string>
+#include <array>
+#include <map>
+#include <stdint.h>
+
+#include "common.hpp"
+
+// Which character each letter (0 to ALPHABET_LENGTH - 1) is. Characters are
+// UTF-8, and are matched when the word lists are loaded, so everything after
+// that only sees letter numbers. The default is a-z, which is also what any
+// list gets first (so a-z lists come out exactly as they always did); other
+// characters the lists use come after, in code point order, for as many as
+// ALPHABET_LENGTH has room for.
+class Alphabet {
+public:
+    Alphabet();  // a-z, or as much of it as fits
+
+    // a-z plus whatever else these words use, after to_lower_case. Words are
+    // split with split_characters, so should be valid UTF-8.
+    static Alphabet from_words(const std::vector<std::string>& words);
+
+    uletter_int size() const;
+    // Letters past size() (ALPHABET_LENGTH with room to spare) come out as eg "[30]"
+    std::string get_letter_string(uletter_int letter) const;
+
+    // False if word isn't WORD_LENGTH characters that are all in this alphabet
+    // (once it's been through to_lower_case)
+    bool to_word(const std::string& word, WordArray& dest) const;
+    std::string to_string(const WordArray& word) const;
+
+private:
+    void _add_letter(const std::string& character);
+    bool _find_letter(const std::string& character, uletter_int& letter_dest) const;
+
+    static constexpr int16_t NOT_A_LETTER = -1;
+
+    std::vector<std::string> letters;
+    // Single byte characters are a lookup, anything longer goes to the map
+    std::array<int16_t, 256> byte_to_letter;
+    std::map<std::string, uletter_int> multibyte_to_letter;
+};
+
+// Splits a UTF-8 string into its characters (code points). False if it isn't
+// valid UTF-8.
+bool split_characters(const std::string& word, std::vector<std::string>& characters_dest);
+
+// word with its capital letters made lowercase, so that eg "Écrou" and "écrou"
+// are the same word. Covers a-z and the cased scripts is_letter_character
+// allows. Anything that isn't valid UTF-8 comes back as is.
+std::string to_lower_case(const std::string& word);
+
+// True if character (one of split_characters's) is a letter: a-z, or a letter
+// from one of the scripts word games get made for (accented Latin, Greek,
+// Cyrillic, Armenian, Georgian, Hebrew, Arabic, Hangul and kana). Punctuation,
+// symbols, digits and combining marks aren't, and neither is anything else.
+bool is_letter_character(const std::string& character);
+
+// What word_vec_to_string and friends use. Set once, when the lists are loaded.
+void set_alphabet(const Alphabet& alphabet);
+const Alphabet& get_alphabet();
+
+#endif
@@ -0,0 +1,77 @@
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <chrono>
+
+#include "anytime.hpp"
+#include "get_suggestion.hpp"
+#include "word_restriction.hpp"
+#include "common.hpp"
+
+AnytimeSearch::AnytimeSearch(
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers,
+    const WordRestriction& restriction,
+    std::size_t num_wanted
+) :
+    possible_guesses(possible_guesses),
+    possible_answers(possible_answers),
+    restriction(restriction),
+    num_wanted(num_wanted),
+    so_far(num_wanted)
+{
+    // Otherwise a deadline that comes before the worker gets going would see
+    // 0 of 0 guesses done, which looks complete
+    so_far.start(possible_guesses.size());
+    worker = std::thread(&AnytimeSearch::_run, this);
+}
+
+AnytimeSearch::~AnytimeSearch() {
+    _stop();
+}
+
+AnytimeResult AnytimeSearch::get_best(std::chrono::steady_clock::time_point deadline, bool keep_refining) {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done_cv.wait_until(lock, deadline, [&]() {return is_finished; });
+    }
+    if (!keep_refining) {
+        _stop();
+    }
+
+    // Coverage first, so that if it says complete, the guesses are final
+    AnytimeResult result;
+    result.coverage = so_far.get_coverage();
+    result.ranked_guesses = so_far.get_ranked_guesses();
+    return result;
+}
+
+bool AnytimeSearch::is_complete() const {
+    return so_far.get_coverage().is_complete();
+}
+
+void AnytimeSearch::_stop() {
+    so_far.request_stop();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void AnytimeSearch::_run() {
+    // The result is the same as so_far's, which is what gets handed out
+    get_top_ranked_guesses(
+        possible_guesses,
+        possible_answers,
+        restriction,
+        num_wanted,
+        nullptr,
+        false,
+        nullptr,
+        &so_far
+    );
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        is_finished = true;
+    }
+    done_cv.notify_all();
+}
@@ -0,0 +1,64 @@
+#ifndef anytime_hpp
+#define anytime_hpp
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include "word_restriction.hpp"
+#include "get_suggestion.hpp"
+#include "common.hpp"
+
+// What an AnytimeSearch had at a deadline
+struct AnytimeResult {
+    std::vector<RankedGuess> ranked_guesses;  // best of what was scored, best first
+    TopGuessesCoverage coverage;
+};
+
+// Suggestions within a time limit (--deadline-ms). get_top_ranked_guesses runs
+// in the background from the moment this is made, most promising guesses first,
+// and whatever is best so far can be taken at any time. If everything got
+// scored, that's exactly what get_top_ranked_guesses returns.
+class AnytimeSearch {
+public:
+    AnytimeSearch(
+        const std::vector<WordArray>& possible_guesses,
+        const std::vector<WordArray>& possible_answers,
+        const WordRestriction& restriction,
+        std::size_t num_wanted
+    );
+    ~AnytimeSearch();
+
+    AnytimeSearch(const AnytimeSearch&) = delete;
+    AnytimeSearch& operator=(const AnytimeSearch&) = delete;
+
+    // Waits until everything is scored or until deadline, whichever comes
+    // first, and returns the best so far. Unless keep_refining, the search is
+    // stopped there (once every thread finishes what it's on); otherwise it
+    // carries on, and the next call picks up where it got to.
+    AnytimeResult get_best(std::chrono::steady_clock::time_point deadline, bool keep_refining);
+
+    // True once every guess has been scored or ruled out
+    bool is_complete() const;
+
+private:
+    void _run();
+    void _stop();
+
+    const std::vector<WordArray> possible_guesses;
+    const std::vector<WordArray> possible_answers;
+    const WordRestriction restriction;
+    const std::size_t num_wanted;
+
+    TopGuessesSoFar so_far;
+
+    std::mutex mutex;
+    std::condition_variable done_cv;
+    bool is_finished = false;
+
+    std::thread worker;
+};
+
+#endif
@@ -0,0 +1,176 @@
+#include <vector>
+#include <string>
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <cstddef>
+#include <mutex>
+#include <chrono>
+
+#include "checkpoint.hpp"
+#include "partial_results.hpp"
+#include "profiler.hpp"
+#include "common.hpp"
+
+static constexpr char CHECKPOINT_MAGIC[8] = {'W', 'S', 'C', 'K', 'P', 'T', '0', '1'};
+
+struct CheckpointHeader {
+    uint64_t dictionary_hash;
+    uint64_t num_guesses;
+    uint64_t num_answers;
+};
+
+// What actually goes in the file per result
+struct CheckpointRecord {
+    uint32_t guess_index;
+    float mean;
+    float median;
+    float stddev;
+    uint32_t checksum;
+};
+
+static uint32_t get_record_checksum(const CheckpointRecord& record) {
+    // FNV-1a over everything but the checksum itself
+    uint32_t checksum = 0x811c9dc5;
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&record);
+    for (std::size_t index = 0; index < offsetof(CheckpointRecord, checksum); index++) {
+        checksum ^= bytes[index];
+        checksum *= 0x01000193;
+    }
+    return checksum;
+}
+
+static CheckpointRecord result_to_record(const GuessResult& result) {
+    CheckpointRecord record = {
+        result.guess_index,
+        result.stats.mean,
+        result.stats.median,
+        result.stats.stddev,
+        0
+    };
+    record.checksum = get_record_checksum(record);
+    return record;
+}
+
+static void write_header(std::ofstream& fout, const CheckpointHeader& header) {
+    fout.write(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+static void write_record(std::ofstream& fout, const GuessResult& result) {
+    CheckpointRecord record = result_to_record(result);
+    fout.write(reinterpret_cast<const char*>(&record), sizeof(record));
+}
+
+// Every intact record in filename, in order. Stops at the first record that's
+// cut short or fails its checksum - anything after that point can't be trusted.
+static std::vector<GuessResult> read_checkpoint(
+    const std::string& filename,
+    const CheckpointHeader& expected_header
+) {
+    std::ifstream fin(filename, std::ios::in | std::ios::binary);
+    if (!fin.is_open()) {
+        throw std::runtime_error(std::string("Could not open file ") + filename);
+    }
+
+    char magic[sizeof(CHECKPOINT_MAGIC)];
+    CheckpointHeader header;
+    fin.read(magic, sizeof(magic));
+    fin.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!fin || std::memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic))) {
+        throw std::runtime_error(filename + " is not a checkpoint file");
+    }
+    if (
+        header.dictionary_hash != expected_header.dictionary_hash
+        || header.num_guesses != expected_header.num_guesses
+        || header.num_answers != expected_header.num_answers
+    ) {
+        throw std::runtime_error(
+            filename + " was made with different word lists, refusing to resume from it"
+        );
+    }
+
+    std::vector<GuessResult> results;
+    std::vector<bool> is_guess_seen(header.num_guesses, false);
+    CheckpointRecord record;
+    while (fin.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+        if (
+            record.checksum != get_record_checksum(record)
+            || record.guess_index >= header.num_guesses
+        ) {
+            break;
+        }
+        if (is_guess_seen[record.guess_index]) {
+            continue;
+        }
+        is_guess_seen[record.guess_index] = true;
+        results.push_back({record.guess_index, {record.mean, record.median, record.stddev}});
+    }
+    return results;
+}
+
+CheckpointLog::CheckpointLog(
+    const std::string& filename,
+    uint64_t dictionary_hash,
+    uint64_t num_guesses,
+    uint64_t num_answers,
+    bool is_resume
+) : filename(filename), last_flush(std::chrono::steady_clock::now()) {
+    ProfileTimer timer(PROFILE_IO);
+    CheckpointHeader header = {dictionary_hash, num_guesses, num_answers};
+
+    if (is_resume && std::ifstream(filename).is_open()) {
+        finished_results = read_checkpoint(filename, header);
+    }
+
+    // Start from a clean copy of whatever survived, so that a torn record at the
+    // end of the old file doesn't sit in front of everything appended from now on.
+    std::string temp_filename = filename + ".tmp";
+    {
+        std::ofstream temp_fout(temp_filename, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!temp_fout.is_open()) {
+            throw std::runtime_error(std::string("Could not open file ") + temp_filename);
+        }
+        write_header(temp_fout, header);
+        for (const auto& result : finished_results) {
+            write_record(temp_fout, result);
+        }
+        if (!temp_fout) {
+            throw std::runtime_error(std::string("Could not write file ") + temp_filename);
+        }
+    }
+    // One step, so a kill here leaves either the old checkpoint or the new one
+    replace_file(temp_filename, filename);
+
+    fout.open(filename, std::ios::out | std::ios::binary | std::ios::app);
+    if (!fout.is_open()) {
+        throw std::runtime_error(std::string("Could not open file ") + filename);
+    }
+}
+
+CheckpointLog::~CheckpointLog() {
+    flush();
+}
+
+const std::vector<GuessResult>& CheckpointLog::get_finished_results() const {
+    return finished_results;
+}
+
+void CheckpointLog::append(const std::vector<GuessResult>& results) {
+    ProfileTimer timer(PROFILE_IO);
+    std::lock_guard<std::mutex> lock(fout_mutex);
+    for (const auto& result : results) {
+        write_record(fout, result);
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_flush >= CHECKPOINT_INTERVAL) {
+        fout.flush();
+        last_flush = now;
+    }
+}
+
+void CheckpointLog::flush() {
+    std::lock_guard<std::mutex> lock(fout_mutex);
+    fout.flush();
+    last_flush = std::chrono::steady_clock::now();
+}
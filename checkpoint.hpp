@@ -0,0 +1,53 @@
+#ifndef checkpoint_hpp
+#define checkpoint_hpp
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <mutex>
+#include <chrono>
+#include <stdint.h>
+
+#include "partial_results.hpp"
+#include "get_suggestion.hpp"
+#include "common.hpp"
+
+// Append only log of finished guess results, so a long search that gets killed
+// can pick up where it left off (--checkpoint/--resume). Each record carries its
+// own checksum, so a record cut off part way through by a crash is just dropped
+// on resume instead of poisoning everything after it.
+class CheckpointLog {
+public:
+    // If is_resume and filename exists, loads the records already in it (see
+    // get_finished_results) and keeps appending to it. Throws std::runtime_error
+    // if it was made with different word lists. Otherwise starts a new log.
+    CheckpointLog(
+        const std::string& filename,
+        uint64_t dictionary_hash,
+        uint64_t num_guesses,
+        uint64_t num_answers,
+        bool is_resume
+    );
+    ~CheckpointLog();
+
+    CheckpointLog(const CheckpointLog&) = delete;
+    CheckpointLog& operator=(const CheckpointLog&) = delete;
+
+    const std::vector<GuessResult>& get_finished_results() const;
+
+    // Thread safe. Flushed to disk at most every CHECKPOINT_INTERVAL, and on
+    // destruction.
+    void append(const std::vector<GuessResult>& results);
+    void flush();
+
+    static constexpr std::chrono::seconds CHECKPOINT_INTERVAL{2};
+
+private:
+    std::string filename;
+    std::ofstream fout;
+    std::mutex fout_mutex;
+    std::chrono::steady_clock::time_point last_flush;
+    std::vector<GuessResult> finished_results;
+};
+
+#endif
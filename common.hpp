@@ -2,13 +2,26 @@
 #define common_hpp
 
 #include<array>
+#include<string>
 #include<stdint.h>
 
 typedef uint8_t uletter_int;
 typedef int8_t  letter_int;
 
 constexpr uletter_int WORD_LENGTH = 5;
-constexpr uletter_int ALPHABET_LENGTH = 26;
+
+// Number of letters a word list can use. 26 is plain a-z; build with eg
+// /DWORDLE_ALPHABET_LENGTH=40 for lists with accented or non-Latin letters
+// (see alphabet.hpp for which characters get which letters). Letter masks are
+// as wide as this needs, see letter_mask.hpp.
+#ifndef WORDLE_ALPHABET_LENGTH
+#define WORDLE_ALPHABET_LENGTH 26
+#endif
+constexpr uletter_int ALPHABET_LENGTH = WORDLE_ALPHABET_LENGTH;
+static_assert(
+    ALPHABET_LENGTH >= 1 && ALPHABET_LENGTH <= 128,
+    "Letter masks go up to 128 bits"
+);
 
 typedef std::array<uletter_int, WORD_LENGTH> WordArray;
 typedef std::array<uletter_int, ALPHABET_LENGTH> AlphabetArray;
@@ -17,25 +30,16 @@ typedef std::array<letter_int, WORD_LENGTH> ResponseArray;
 constexpr ResponseArray EMPTY_RESPONSE = {};
 constexpr AlphabetArray EMPTY_ALPHABET_ARRAY = {};
 
-// This is stupid. There has to be a better way that would not have to be
-// modified if ALPHABET_LENGTH changed
-constexpr AlphabetArray MAX_VAL_ALPHABET_ARRAY = {  // Ugh
-    ALPHABET_LENGTH, ALPHABET_LENGTH, ALPHABET_LENGTH, ALPHABET_LENGTH, ALPHABET_LENGTH,
-    ALPHABET_LENGTH, ALPHABET_LENGTH, ALPHABET_LENGTH, ALPHABET_LENGTH, ALPHABET_LENGTH,
-    ALPHABET_LENGTH, ALPHABET_LENGTH, ALPHABET_LENGTH, ALPHABET_LENGTH, ALPHABET_LENGTH,
-    ALPHABET_LENGTH, ALPHABET_LENGTH, ALPHABET_LENGTH, ALPHABET_LENGTH, ALPHABET_LENGTH,
-    ALPHABET_LENGTH, ALPHABET_LENGTH, ALPHABET_LENGTH, ALPHABET_LENGTH, ALPHABET_LENGTH,
-    ALPHABET_LENGTH,
-};
-
-constexpr AlphabetArray WORD_LEN_ALPHABET_ARRAY = {  // Ugh
-    WORD_LENGTH, WORD_LENGTH, WORD_LENGTH, WORD_LENGTH, WORD_LENGTH,
-    WORD_LENGTH, WORD_LENGTH, WORD_LENGTH, WORD_LENGTH, WORD_LENGTH,
-    WORD_LENGTH, WORD_LENGTH, WORD_LENGTH, WORD_LENGTH, WORD_LENGTH,
-    WORD_LENGTH, WORD_LENGTH, WORD_LENGTH, WORD_LENGTH, WORD_LENGTH,
-    WORD_LENGTH, WORD_LENGTH, WORD_LENGTH, WORD_LENGTH, WORD_LENGTH,
-    WORD_LENGTH
-};
+constexpr AlphabetArray make_filled_alphabet_array(uletter_int value) {
+    AlphabetArray filled = {};
+    for (auto& element : filled) {
+        element = value;
+    }
+    return filled;
+}
+
+constexpr AlphabetArray MAX_VAL_ALPHABET_ARRAY = make_filled_alphabet_array(ALPHABET_LENGTH);
+constexpr AlphabetArray WORD_LEN_ALPHABET_ARRAY = make_filled_alphabet_array(WORD_LENGTH);
 
 std::string word_vec_to_string(const WordArray& word_arr);
 
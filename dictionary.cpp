@@ -0,0 +1,246 @@
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <chrono>
+#include <filesystem>
+#include <stdexcept>
+#include <stdint.h>
+
+#include "dictionary.hpp"
+#include "get_suggestion.hpp"
+#include "response_code.hpp"
+#include "profiler.hpp"
+#include "common.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+bool DictionaryDiff::empty() const {
+    return (
+        added_guesses.empty()
+        && removed_guesses.empty()
+        && added_answers.empty()
+        && removed_answers.empty()
+    );
+}
+
+// Words in new_words but not old_words, and the other way around
+static void diff_words(
+    const std::vector<WordArray>& old_words,
+    const std::vector<WordArray>& new_words,
+    std::vector<WordArray>& added_dest,
+    std::vector<WordArray>& removed_dest
+) {
+    std::vector<WordArray> sorted_old = old_words;
+    std::vector<WordArray> sorted_new = new_words;
+    std::sort(sorted_old.begin(), sorted_old.end());
+    std::sort(sorted_new.begin(), sorted_new.end());
+    std::set_difference(
+        sorted_new.begin(),
+        sorted_new.end(),
+        sorted_old.begin(),
+        sorted_old.end(),
+        std::back_inserter(added_dest)
+    );
+    std::set_difference(
+        sorted_old.begin(),
+        sorted_old.end(),
+        sorted_new.begin(),
+        sorted_new.end(),
+        std::back_inserter(removed_dest)
+    );
+}
+
+DictionaryDiff diff_dictionary(
+    const Dictionary& old_dictionary,
+    const std::vector<WordArray>& guesses,
+    const std::vector<WordArray>& answers
+) {
+    DictionaryDiff diff;
+    diff_words(old_dictionary.guesses, guesses, diff.added_guesses, diff.removed_guesses);
+    diff_words(old_dictionary.answers, answers, diff.added_answers, diff.removed_answers);
+    return diff;
+}
+
+// Everything but the opening histograms
+static std::shared_ptr<Dictionary> build_tables(
+    const std::vector<WordArray>& guesses,
+    const std::vector<WordArray>& answers,
+    const DictionaryOptions& options
+) {
+    auto dictionary = std::make_shared<Dictionary>();
+    dictionary->options = options;
+    dictionary->guesses = guesses;
+    dictionary->answers = answers;
+    dictionary->answer_table = WordTable(answers);
+    if (options.with_guess_table) {
+        dictionary->guess_table = WordTable(guesses);
+    }
+    if (options.with_tries) {
+        dictionary->answer_trie = WordTrie(answers);
+        dictionary->guess_trie = WordTrie(guesses);
+    }
+    return dictionary;
+}
+
+static void fill_opening_stats(Dictionary& dictionary) {
+    dictionary.opening_stats.resize(dictionary.guesses.size());
+    for (std::size_t guess_index = 0; guess_index < dictionary.guesses.size(); guess_index++) {
+        dictionary.opening_stats[guess_index] = get_stats_from_histogram(
+            dictionary.opening_histograms[guess_index],
+            dictionary.answers.size()
+        );
+    }
+}
+
+std::shared_ptr<const Dictionary> build_dictionary(
+    const std::vector<WordArray>& guesses,
+    const std::vector<WordArray>& answers,
+    const DictionaryOptions& options
+) {
+    auto start = Clock::now();
+    std::shared_ptr<Dictionary> dictionary = build_tables(guesses, answers, options);
+    if (options.with_opening_stats) {
+        ProfileTimer timer(PROFILE_SCORE);
+        dictionary->opening_histograms = get_response_histograms(guesses, answers);
+        fill_opening_stats(*dictionary);
+    }
+    dictionary->build_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return dictionary;
+}
+
+std::shared_ptr<const Dictionary> patch_dictionary(
+    const Dictionary& old_dictionary,
+    const std::vector<WordArray>& guesses,
+    const std::vector<WordArray>& answers
+) {
+    auto start = Clock::now();
+    std::shared_ptr<Dictionary> dictionary = build_tables(guesses, answers, old_dictionary.options);
+    dictionary->version = old_dictionary.version + 1;
+    dictionary->diff = diff_dictionary(old_dictionary, guesses, answers);
+
+    if (old_dictionary.options.with_opening_stats) {
+        ProfileTimer timer(PROFILE_SCORE);
+        std::map<WordArray, std::size_t> old_guess_to_index;
+        for (std::size_t guess_index = 0; guess_index < old_dictionary.guesses.size(); guess_index++) {
+            old_guess_to_index[old_dictionary.guesses[guess_index]] = guess_index;
+        }
+
+        // Rows for guesses that were already there, patched for the answers that changed
+        const DictionaryDiff& diff = dictionary->diff;
+        dictionary->opening_histograms.resize(guesses.size());
+        const int64_t num_guesses = guesses.size();
+        // guess_index is signed to make omp happy
+        #pragma omp parallel for schedule(dynamic, 256)
+        for (int64_t guess_index = 0; guess_index < num_guesses; guess_index++) {
+            auto found = old_guess_to_index.find(guesses[guess_index]);
+            if (found == old_guess_to_index.end()) {
+                continue;
+            }
+            ResponseHistogram& histogram = dictionary->opening_histograms[guess_index];
+            histogram = old_dictionary.opening_histograms[found->second];
+            for (const auto& answer : diff.removed_answers) {
+                histogram[calculate_response_code(guesses[guess_index], answer)]--;
+            }
+            for (const auto& answer : diff.added_answers) {
+                histogram[calculate_response_code(guesses[guess_index], answer)]++;
+            }
+        }
+
+        // And new guesses scored from scratch
+        std::vector<WordArray> new_guesses;
+        std::vector<std::size_t> new_guess_indexes;
+        for (std::size_t guess_index = 0; guess_index < guesses.size(); guess_index++) {
+            if (old_guess_to_index.find(guesses[guess_index]) == old_guess_to_index.end()) {
+                new_guesses.push_back(guesses[guess_index]);
+                new_guess_indexes.push_back(guess_index);
+            }
+        }
+        std::vector<ResponseHistogram> new_histograms = get_response_histograms(new_guesses, answers);
+        for (std::size_t index = 0; index < new_guesses.size(); index++) {
+            dictionary->opening_histograms[new_guess_indexes[index]] = new_histograms[index];
+        }
+
+        fill_opening_stats(*dictionary);
+    }
+    dictionary->build_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return dictionary;
+}
+
+DictionaryWatcher::DictionaryWatcher(
+    const std::string& guesses_file,
+    const std::string& answers_file,
+    const WordLoader& load_words,
+    std::shared_ptr<const Dictionary> initial
+) :
+    guesses_file(guesses_file),
+    answers_file(answers_file),
+    load_words(load_words),
+    latest(std::move(initial))
+{
+    worker = std::thread(&DictionaryWatcher::_run, this);
+}
+
+DictionaryWatcher::~DictionaryWatcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    stop_cv.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+std::shared_ptr<const Dictionary> DictionaryWatcher::get_latest() const {
+    return latest.load();
+}
+
+std::optional<std::string> DictionaryWatcher::take_error() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::optional<std::string> taken = std::move(error);
+    error.reset();
+    return taken;
+}
+
+void DictionaryWatcher::_run() {
+    // Missing files read as the same "time" until they're back
+    auto get_write_times = [&]() {
+        std::error_code guesses_error, answers_error;
+        return std::make_pair(
+            std::filesystem::last_write_time(guesses_file, guesses_error),
+            std::filesystem::last_write_time(answers_file, answers_error)
+        );
+    };
+    auto last_write_times = get_write_times();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stop_cv.wait_for(lock, POLL_INTERVAL, [&]() {return stop; })) {
+        auto write_times = get_write_times();
+        if (write_times == last_write_times) {
+            continue;
+        }
+        last_write_times = write_times;
+        lock.unlock();
+
+        std::optional<std::string> reload_error;
+        try {
+            std::vector<WordArray> guesses = load_words(guesses_file);
+            std::vector<WordArray> answers = load_words(answers_file);
+            std::shared_ptr<const Dictionary> patched = patch_dictionary(*latest.load(), guesses, answers);
+            // eg the file was just touched, or only reordered
+            if (!patched->diff.empty()) {
+                latest.store(std::move(patched));
+            }
+        } catch (const std::exception& exc) {
+            reload_error = std::string("Couldn't reload the word lists: ") + exc.what();
+        }
+
+        lock.lock();
+        if (reload_error.has_value()) {
+            error = std::move(reload_error);
+        }
+    }
+}
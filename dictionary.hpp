@@ -0,0 +1,129 @@
+#ifndef dictionary_hpp
+#define dictionary_hpp
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <optional>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <stdint.h>
+
+#include "get_suggestion.hpp"
+#include "word_table.hpp"
+#include "word_trie.hpp"
+#include "common.hpp"
+
+// The word lists, and everything built from them that the interactive loop
+// keeps around. With --watch, the files are reloaded when they change: the new
+// version is patched from the old one (only guess/answer pairs involving a
+// changed word get scored) and swapped in whole, so anything still using the
+// old version (speculation, a --refine search) finishes with a consistent one.
+
+// Which of the optional parts to build
+struct DictionaryOptions {
+    bool with_guess_table = false;    // for hard mode
+    bool with_tries = false;          // for --trie
+    bool with_opening_stats = false;  // for --watch
+};
+
+struct DictionaryDiff {
+    std::vector<WordArray> added_guesses;
+    std::vector<WordArray> removed_guesses;
+    std::vector<WordArray> added_answers;
+    std::vector<WordArray> removed_answers;
+
+    bool empty() const;
+};
+
+// Never changed once made
+struct Dictionary {
+    uint64_t version = 0;
+    DictionaryOptions options;
+    std::vector<WordArray> guesses;
+    std::vector<WordArray> answers;
+
+    WordTable answer_table;
+    WordTable guess_table;
+    WordTrie answer_trie;
+    WordTrie guess_trie;
+
+    // Each guess's histogram against every answer, and its stats from that -
+    // ie, the scores for the first turn. The histograms are what makes patching
+    // cheap: a changed answer only moves one count per guess.
+    std::vector<ResponseHistogram> opening_histograms;
+    std::vector<GuessStats> opening_stats;
+
+    DictionaryDiff diff;  // from the version before, if any
+    double build_seconds = 0;
+};
+
+DictionaryDiff diff_dictionary(
+    const Dictionary& old_dictionary,
+    const std::vector<WordArray>& guesses,
+    const std::vector<WordArray>& answers
+);
+
+std::shared_ptr<const Dictionary> build_dictionary(
+    const std::vector<WordArray>& guesses,
+    const std::vector<WordArray>& answers,
+    const DictionaryOptions& options
+);
+
+// The same as build_dictionary(guesses, answers, old_dictionary.options), one
+// version later. Opening histograms of guesses that were already there are
+// patched with just the added and removed answers, and only new guesses are
+// scored against every answer. The tables and tries are rebuilt, since that's
+// a single pass over the words anyway.
+std::shared_ptr<const Dictionary> patch_dictionary(
+    const Dictionary& old_dictionary,
+    const std::vector<WordArray>& guesses,
+    const std::vector<WordArray>& answers
+);
+
+// Checks the word list files every POLL_INTERVAL, and when either has
+// changed, builds the next version in the background. get_latest is what the
+// main loop swaps to.
+class DictionaryWatcher {
+public:
+    typedef std::function<std::vector<WordArray>(const std::string& filename)> WordLoader;
+    static constexpr std::chrono::milliseconds POLL_INTERVAL{1000};
+
+    DictionaryWatcher(
+        const std::string& guesses_file,
+        const std::string& answers_file,
+        const WordLoader& load_words,
+        std::shared_ptr<const Dictionary> initial
+    );
+    ~DictionaryWatcher();
+
+    DictionaryWatcher(const DictionaryWatcher&) = delete;
+    DictionaryWatcher& operator=(const DictionaryWatcher&) = delete;
+
+    std::shared_ptr<const Dictionary> get_latest() const;
+
+    // Why the last reload failed, if it did and this hasn't been asked since
+    std::optional<std::string> take_error();
+
+private:
+    void _run();
+
+    const std::string guesses_file;
+    const std::string answers_file;
+    const WordLoader load_words;
+
+    std::atomic<std::shared_ptr<const Dictionary>> latest;
+
+    std::mutex mutex;
+    std::condition_variable stop_cv;
+    bool stop = false;
+    std::optional<std::string> error;
+
+    std::thread worker;
+};
+
+#endif
@@ -7,95 +7,319 @@
 #include <iomanip>
 
 #include <atomic>
+#include <mutex>
+#include <queue>
+#include <cstring>
+#include <stdexcept>
 
 #include <algorithm>
 #include <numeric>
+#include <cmath>
+#include <chrono>
 #include <omp.h>
 
 #include "get_suggestion.hpp"
+#include "profiler.hpp"
+#include "numa.hpp"
 #include "word_restriction.hpp"
 #include "common.hpp"
 
 static constexpr float EPSILON = 0.00001;
 
-inline ResponseArray calculate_response(
-    const WordArray& guess,
-    const WordArray& answer
-){
-    ResponseArray response = EMPTY_RESPONSE;
-    AlphabetArray letter_count = EMPTY_ALPHABET_ARRAY;
-    AlphabetArray letter_to_green_count = EMPTY_ALPHABET_ARRAY;
+// Guesses are checked against the pruning threshold this many times while
+// being scored, but not more often than every this many answers.
+static constexpr std::size_t NUM_PRUNING_CHECKS = 16;
+static constexpr std::size_t MIN_ANSWERS_BETWEEN_PRUNING_CHECKS = 128;
 
-    for (uletter_int index = 0; index < WORD_LENGTH; index++) {
-        if (answer[index] == guess[index]) {
-            response[index] = 2;
-            letter_to_green_count[answer[index]] += 1;
-        }
-        letter_count[answer[index]]++;
-    }
+// Weighted medians come from a running float total, so the weighted bounds
+// leave this much (as a fraction of the total weight) for rounding
+static constexpr double WEIGHT_SLACK = 0.00001;
 
-    for (uletter_int index = 0; index < WORD_LENGTH; index++) {
-        if (
-            guess[index] != answer[index]
-            && letter_count[guess[index]] > letter_to_green_count[guess[index]]
-        ) {
-            response[index] = 1;
-            letter_count[guess[index]]--;
-        }
-    }
+static ScoringTileSizes tile_sizes;
 
-    return response;
+// Answer weights by word_to_key, empty if answers aren't weighted
+static std::unordered_map<uint64_t, float> word_key_to_weight;
+
+// Total weight of the answers in each bucket, alongside a ResponseHistogram
+typedef std::array<float, NUM_RESPONSES> WeightHistogram;
+
+// uint64_t since ALPHABET_LENGTH^WORD_LENGTH can be past 32 bits
+static uint64_t word_to_key(const WordArray& word) {
+    uint64_t key = 0;
+    for (auto letter : word) {
+        key = key * ALPHABET_LENGTH + letter;
+    }
+    return key;
 }
 
-void get_remaining_answers(
-    const WordArray& guess,
+// Adds, for each guess in tile_guesses, how many of the answers get
+// each response. Goes through the guess x answer grid in tiles, so that a block
+// of answers stays in cache while every guess in the block is run against it,
+// instead of streaming the whole answer list through once per guess.
+// Only answers [answers_begin, answers_end) are counted. If answer_weights is
+// given, each answer's weight is also added to weight_histograms_dest.
+static void add_response_histograms(
+    const std::vector<WordArray>& tile_guesses,
     const std::vector<WordArray>& possible_answers,
-    const WordRestriction& base_restriction,
-    std::vector<uint32_t>& num_answers_dest_vec,
-    float& mean,
-    float& median,
-    float& stddev
-) {
-    std::size_t answer_index = 0;
-    uint32_t running_total = 0;
-    for (const auto& answer : possible_answers) {
-        WordRestriction restriction = base_restriction;
-        ResponseArray response = calculate_response(guess, answer);
-        restriction.update_from_word_guess(guess, response);
+    std::size_t answers_begin,
+    std::size_t answers_end,
+    const ScoringTileSizes& sizes,
+    std::vector<ResponseHistogram>& histograms_dest,
+    const float* answer_weights = nullptr,
+    std::vector<WeightHistogram>* weight_histograms_dest = nullptr
+) {
+    ProfileTimer timer(PROFILE_RESPONSE);
+    if (g_profiling_enabled) {
+        get_thread_profile().response_pairs += tile_guesses.size() * (answers_end - answers_begin);
+    }
+    for (
+        std::size_t answer_begin = answers_begin;
+        answer_begin < answers_end;
+        answer_begin += sizes.num_answers
+    ) {
+        std::size_t answer_end = std::min(answer_begin + sizes.num_answers, answers_end);
+        for (std::size_t tile_index = 0; tile_index < tile_guesses.size(); tile_index++) {
+            const WordArray& guess = tile_guesses[tile_index];
+            ResponseHistogram& histogram = histograms_dest[tile_index];
+            if (answer_weights == nullptr) {
+                for (std::size_t answer_index = answer_begin; answer_index < answer_end; answer_index++) {
+                    histogram[calculate_response_code(guess, possible_answers[answer_index])]++;
+                }
+                continue;
+            }
+            WeightHistogram& weight_histogram = (*weight_histograms_dest)[tile_index];
+            for (std::size_t answer_index = answer_begin; answer_index < answer_end; answer_index++) {
+                uint32_t response_index = calculate_response_code(guess, possible_answers[answer_index]);
+                histogram[response_index]++;
+                weight_histogram[response_index] += answer_weights[answer_index];
+            }
+        }
+    }
+}
 
-        num_answers_dest_vec[answer_index] = 0;
-        for (const auto& possible_answer : possible_answers) {
-            num_answers_dest_vec[answer_index] += restriction.is_word_allowed(possible_answer);
+GuessStats get_stats_from_histogram(
+    const ResponseHistogram& histogram,
+    std::size_t num_answers
+) {
+    ProfileTimer timer(PROFILE_SCORE);
+    std::array<uint32_t, NUM_RESPONSES> bucket_sizes;
+    std::size_t num_buckets = 0;
+    for (auto bucket_size : histogram) {
+        if (bucket_size) {
+            bucket_sizes[num_buckets] = bucket_size;
+            num_buckets++;
         }
+    }
+    return get_stats_from_bucket_sizes(bucket_sizes.data(), num_buckets, num_answers);
+}
 
-        running_total += num_answers_dest_vec[answer_index];
-        answer_index++;
+GuessStats get_stats_from_bucket_sizes(
+    uint32_t* bucket_sizes,
+    std::size_t num_buckets,
+    std::size_t num_answers
+) {
+    GuessStats stats;
+    if (num_answers == 0) {
+        return stats;
+    }
+
+    uint64_t running_total = 0;
+    for (std::size_t bucket_index = 0; bucket_index < num_buckets; bucket_index++) {
+        running_total += (uint64_t) bucket_sizes[bucket_index] * bucket_sizes[bucket_index];
     }
+    std::sort(bucket_sizes, bucket_sizes + num_buckets);
 
-    std::sort(num_answers_dest_vec.begin(), num_answers_dest_vec.end());
+    // Value at index answer_index of the sorted per answer list, without building it
+    auto get_sorted_value = [&](std::size_t answer_index) {
+        std::size_t seen = 0;
+        for (std::size_t bucket_index = 0; bucket_index < num_buckets; bucket_index++) {
+            seen += bucket_sizes[bucket_index];
+            if (answer_index < seen) {
+                return bucket_sizes[bucket_index];
+            }
+        }
+        return bucket_sizes[num_buckets - 1];
+    };
 
-    mean = (float) running_total / possible_answers.size();
-    if (possible_answers.size() % 2) {
-        median = num_answers_dest_vec[(possible_answers.size() / 2)];
+    stats.mean = (float) running_total / num_answers;
+    if (num_answers % 2) {
+        stats.median = get_sorted_value(num_answers / 2);
     } else {
-        median = (
+        stats.median = (
             (float) (
-                num_answers_dest_vec[(possible_answers.size() / 2) - 1]
-                + num_answers_dest_vec[(possible_answers.size() / 2)]
+                get_sorted_value(num_answers / 2 - 1)
+                + get_sorted_value(num_answers / 2)
             ) / 2
         );
     }
 
-    stddev = 0;
-    for (auto num_answers : num_answers_dest_vec) {
-        stddev += (num_answers - mean) * (num_answers - mean);
+    // Added one answer at a time, in the same order as the per answer list would
+    // be, so the float rounding comes out the same.
+    stats.stddev = 0;
+    for (std::size_t bucket_index = 0; bucket_index < num_buckets; bucket_index++) {
+        float diff = bucket_sizes[bucket_index] - stats.mean;
+        for (uint32_t repeat = 0; repeat < bucket_sizes[bucket_index]; repeat++) {
+            stats.stddev += diff * diff;
+        }
+    }
+    stats.stddev = std::sqrt(stats.stddev / num_answers);
+    return stats;
+}
+
+// Same idea as get_stats_from_histogram, but the answer that's picked is
+// weighted, so a bucket's size counts for its share of total_weight rather than
+// its share of the answers. Its own size still counts every answer in it: the
+// stats are of how many answers are left, not how much weight.
+static GuessStats get_stats_from_weighted_histogram(
+    const ResponseHistogram& histogram,
+    const WeightHistogram& weight_histogram,
+    float total_weight
+) {
+    ProfileTimer timer(PROFILE_SCORE);
+    GuessStats stats;
+
+    std::array<std::pair<uint32_t, float>, NUM_RESPONSES> buckets;  // size, weight
+    std::size_t num_buckets = 0;
+    double mean = 0;
+    double entropy = 0;
+    for (std::size_t response_index = 0; response_index < NUM_RESPONSES; response_index++) {
+        if (histogram[response_index]) {
+            buckets[num_buckets] = {histogram[response_index], weight_histogram[response_index]};
+            num_buckets++;
+            double probability = weight_histogram[response_index] / total_weight;
+            mean += probability * histogram[response_index];
+            if (probability > 0) {
+                entropy -= probability * std::log2(probability);
+            }
+        }
+    }
+    std::sort(buckets.begin(), buckets.begin() + num_buckets);
+
+    // Smallest bucket size with at least half the weight at or below it
+    double weight_so_far = 0;
+    stats.median = buckets[num_buckets - 1].first;
+    for (std::size_t bucket_index = 0; bucket_index < num_buckets; bucket_index++) {
+        weight_so_far += buckets[bucket_index].second;
+        if (weight_so_far >= total_weight / 2) {
+            stats.median = buckets[bucket_index].first;
+            break;
+        }
+    }
+
+    double variance = 0;
+    for (std::size_t bucket_index = 0; bucket_index < num_buckets; bucket_index++) {
+        double diff = buckets[bucket_index].first - mean;
+        variance += buckets[bucket_index].second / total_weight * diff * diff;
+    }
+
+    stats.mean = mean;
+    stats.stddev = std::sqrt(variance);
+    stats.entropy = entropy;
+    stats.win_probability = weight_histogram[ALL_GREEN_CODE] / total_weight;
+    return stats;
+}
+
+void set_answer_weights(const std::vector<WordArray>& words, const std::vector<float>& weights) {
+    if (words.size() != weights.size()) {
+        throw std::invalid_argument("Need exactly one weight per word");
+    }
+    word_key_to_weight.clear();
+    for (std::size_t word_index = 0; word_index < words.size(); word_index++) {
+        word_key_to_weight[word_to_key(words[word_index])] = weights[word_index];
+    }
+}
+
+bool has_answer_weights() {
+    return !word_key_to_weight.empty();
+}
+
+WeightArray get_answer_weights(const std::vector<WordArray>& possible_answers) {
+    if (!has_answer_weights()) {
+        return {};
     }
-    stddev = sqrt(stddev / possible_answers.size());
+    WeightArray answer_weights(possible_answers.size(), 0);
+    float total_weight = 0;
+    for (std::size_t answer_index = 0; answer_index < possible_answers.size(); answer_index++) {
+        auto found = word_key_to_weight.find(word_to_key(possible_answers[answer_index]));
+        if (found != word_key_to_weight.end()) {
+            answer_weights[answer_index] = found->second;
+            total_weight += found->second;
+        }
+    }
+    if (total_weight <= 0) {
+        return {};
+    }
+    return answer_weights;
+}
+
+ScoringTileSizes get_tile_sizes() {
+    return tile_sizes;
+}
+
+void set_tile_sizes(const ScoringTileSizes& sizes) {
+    tile_sizes = sizes;
+}
+
+ScoringTileSizes autotune_tile_sizes(
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers
+) {
+    static constexpr std::size_t NUM_SAMPLE_GUESSES = 128;
+    static constexpr std::array<std::size_t, 4> GUESS_TILE_SIZES = {4, 8, 16, 32};
+    static constexpr std::array<std::size_t, 5> ANSWER_TILE_SIZES = {256, 512, 1024, 2048, 4096};
+
+    // If it all fits in a tile anyway, there's nothing to tune
+    if (
+        possible_guesses.size() < NUM_SAMPLE_GUESSES
+        || possible_answers.size() <= ANSWER_TILE_SIZES.front()
+    ) {
+        return tile_sizes;
+    }
+
+    ScoringTileSizes best_sizes = tile_sizes;
+    auto best_time = std::chrono::steady_clock::duration::max();
+    std::vector<ResponseHistogram> histograms(GUESS_TILE_SIZES.back());
+    for (auto num_tile_guesses : GUESS_TILE_SIZES) {
+        for (auto num_tile_answers : ANSWER_TILE_SIZES) {
+            ScoringTileSizes sizes = {num_tile_guesses, num_tile_answers};
+            auto start = std::chrono::steady_clock::now();
+            for (
+                std::size_t guess_begin = 0;
+                guess_begin < NUM_SAMPLE_GUESSES;
+                guess_begin += num_tile_guesses
+            ) {
+                std::vector<WordArray> tile_guesses(
+                    possible_guesses.begin() + guess_begin,
+                    possible_guesses.begin() + guess_begin + num_tile_guesses
+                );
+                std::fill(histograms.begin(), histograms.end(), ResponseHistogram{});
+                add_response_histograms(
+                    tile_guesses,
+                    possible_answers,
+                    0,
+                    possible_answers.size(),
+                    sizes,
+                    histograms
+                );
+            }
+            auto time = std::chrono::steady_clock::now() - start;
+            if (time < best_time) {
+                best_time = time;
+                best_sizes = sizes;
+            }
+            if (num_tile_answers >= possible_answers.size()) {
+                break;  // bigger answer tiles are all the same as this one
+            }
+        }
+    }
+
+    tile_sizes = best_sizes;
+    return tile_sizes;
 }
 
 static inline bool float_is_less_than(float a, float b) {
     if (
-        abs(a - b) >= EPSILON
+        std::abs(a - b) >= EPSILON
         && a < b
     ) {
         return true;
@@ -103,6 +327,13 @@ static inline bool float_is_less_than(float a, float b) {
     return false;
 }
 
+bool is_better_score(const GuessStats& stats1, const GuessStats& stats2) {
+    return (
+        float_is_less_than(stats1.median, stats2.median)
+        || (std::abs(stats1.median - stats2.median) < EPSILON && float_is_less_than(stats1.mean, stats2.mean))
+    );
+}
+
 static inline bool guess_comparitor(
     float mean1,
     float median1,
@@ -110,23 +341,22 @@ static inline bool guess_comparitor(
     float median2,
     const WordArray& guess1,
     const WordArray& guess2,
-    const WordRestriction& restriction
+    bool guess1_possible,
+    bool guess2_possible
 ) {
-    bool guess1_possible = restriction.is_word_allowed(guess1);
-    bool guess2_possible = restriction.is_word_allowed(guess2);
     if (float_is_less_than(median1, median2)) {
         return true;
-    } else if (abs(median1 - median2) < EPSILON && float_is_less_than(mean1, mean2)) {
+    } else if (std::abs(median1 - median2) < EPSILON && float_is_less_than(mean1, mean2)) {
         return true;
     } else if (
-        abs(median1 - median2) < EPSILON
-        && abs(mean1 - mean2) < EPSILON
+        std::abs(median1 - median2) < EPSILON
+        && std::abs(mean1 - mean2) < EPSILON
         && (guess1_possible && !guess2_possible)
     ) {
         return true;
     } else if (
-        abs(median1 - median2) < EPSILON
-        && abs(mean1 - mean2) < EPSILON
+        std::abs(median1 - median2) < EPSILON
+        && std::abs(mean1 - mean2) < EPSILON
         && (guess1_possible == guess2_possible)
     ) {
         return word_vec_to_string(guess1) < word_vec_to_string(guess2);
@@ -134,98 +364,842 @@ static inline bool guess_comparitor(
     return false;
 }
 
+static inline bool guess_comparitor(
+    float mean1,
+    float median1,
+    float mean2,
+    float median2,
+    const WordArray& guess1,
+    const WordArray& guess2,
+    const WordRestriction& restriction
+) {
+    return guess_comparitor(
+        mean1,
+        median1,
+        mean2,
+        median2,
+        guess1,
+        guess2,
+        restriction.is_word_allowed(guess1),
+        restriction.is_word_allowed(guess2)
+    );
+}
+
+// Same order as rank_guesses
+static inline bool ranked_guess_comparitor(const RankedGuess& ranked_guess1, const RankedGuess& ranked_guess2) {
+    return guess_comparitor(
+        ranked_guess1.stats.mean,
+        ranked_guess1.stats.median,
+        ranked_guess2.stats.mean,
+        ranked_guess2.stats.median,
+        ranked_guess1.guess,
+        ranked_guess2.guess,
+        ranked_guess1.is_un_eliminated,
+        ranked_guess2.is_un_eliminated
+    );
+}
 
-void print_suggestions(
+std::vector<RankedGuess> TopGuessesSoFar::get_ranked_guesses() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return best;
+}
+
+TopGuessesCoverage TopGuessesSoFar::get_coverage() const {
+    TopGuessesCoverage coverage;
+    coverage.num_guesses = num_guesses;
+    coverage.num_scored = num_scored;
+    coverage.num_pruned = num_pruned;
+    return coverage;
+}
+
+void TopGuessesSoFar::request_stop() {
+    stop_requested = true;
+}
+
+bool TopGuessesSoFar::is_stop_requested() const {
+    return stop_requested;
+}
+
+void TopGuessesSoFar::start(std::size_t num_guesses) {
+    std::lock_guard<std::mutex> lock(mutex);
+    best.clear();
+    this->num_guesses = num_guesses;
+    num_scored = 0;
+    num_pruned = 0;
+}
+
+void TopGuessesSoFar::add_scored(const RankedGuess& ranked_guess) {
+    std::lock_guard<std::mutex> lock(mutex);
+    num_scored++;
+    if (num_wanted == 0) {
+        return;
+    }
+    if (best.size() == num_wanted && !ranked_guess_comparitor(ranked_guess, best.back())) {
+        return;
+    }
+    best.insert(
+        std::upper_bound(best.begin(), best.end(), ranked_guess, ranked_guess_comparitor),
+        ranked_guess
+    );
+    if (best.size() > num_wanted) {
+        best.pop_back();
+    }
+}
+
+void TopGuessesSoFar::add_pruned() {
+    num_pruned++;
+}
+
+
+std::vector<GuessStats> get_guess_stats(
     const std::vector<WordArray>& possible_guesses,
     const std::vector<WordArray>& possible_answers,
-    const WordRestriction& restriction
+    const std::vector<std::size_t>& guess_indexes,
+    const std::atomic_bool* cancel_flag,
+    bool show_progress,
+    const TileDoneCallback& on_tile_done
 ) {
-    std::vector<std::vector<uint32_t>> guess_index_to_answer_index_to_num_remaining(
-        possible_guesses.size(),
-        std::vector<uint32_t>(possible_answers.size())
-    );
+    std::vector<GuessStats> stats_vec(guess_indexes.size());
 
-    std::vector<float> means(possible_guesses.size());
-    std::vector<float> medians(possible_guesses.size());
-    std::vector<float> stddevs(possible_guesses.size());
+    const WeightArray answer_weights = get_answer_weights(possible_answers);
+    const float total_weight = std::accumulate(answer_weights.begin(), answer_weights.end(), 0.0f);
 
     std::atomic_uint32_t num_done = 0;
     std::atomic_uint32_t print_lockish = 0;
 
-    std::cout << "\nChecked 0 of " << possible_guesses.size() << "    " << std::flush;
+    if (show_progress) {
+        std::cout << "\nChecked 0 of " << guess_indexes.size() << "    " << std::flush;
+    }
+
+    const ScoringTileSizes sizes = tile_sizes;
+    const int64_t num_guess_tiles = (
+        (guess_indexes.size() + sizes.num_guesses - 1) / sizes.num_guesses
+    );
+    const auto answer_replicas = get_node_replicas(possible_answers);
+    const auto weight_replicas = get_node_replicas(answer_weights);
+    uint64_t loop_start = g_profiling_enabled ? read_cycle_counter() : 0;
+
+    for_each_tile_by_node(num_guess_tiles, [&](int64_t tile_index, std::size_t node_index) {
+        // Can't break out of the parallel loop, so just skip everything that's left
+        if (cancel_flag != nullptr && *cancel_flag) {
+            return;
+        }
+        const std::vector<WordArray>& node_answers = answer_replicas->get(node_index);
+        const WeightArray& node_weights = weight_replicas->get(node_index);
+        uint64_t tile_start = g_profiling_enabled ? read_cycle_counter() : 0;
+        std::size_t tile_begin = tile_index * sizes.num_guesses;
+        std::size_t tile_end = std::min(tile_begin + sizes.num_guesses, guess_indexes.size());
+
+        std::vector<WordArray> tile_guesses;
+        tile_guesses.reserve(tile_end - tile_begin);
+        for (std::size_t index = tile_begin; index < tile_end; index++) {
+            tile_guesses.push_back(possible_guesses[guess_indexes[index]]);
+        }
+
+        std::vector<ResponseHistogram> histograms(tile_guesses.size());
+        if (answer_weights.empty()) {
+            add_response_histograms(
+                tile_guesses,
+                node_answers,
+                0,
+                possible_answers.size(),
+                sizes,
+                histograms
+            );
+            for (std::size_t index = tile_begin; index < tile_end; index++) {
+                stats_vec[index] = get_stats_from_histogram(
+                    histograms[index - tile_begin],
+                    possible_answers.size()
+                );
+            }
+        } else {
+            std::vector<WeightHistogram> weight_histograms(tile_guesses.size());
+            add_response_histograms(
+                tile_guesses,
+                node_answers,
+                0,
+                possible_answers.size(),
+                sizes,
+                histograms,
+                node_weights.data(),
+                &weight_histograms
+            );
+            for (std::size_t index = tile_begin; index < tile_end; index++) {
+                stats_vec[index] = get_stats_from_weighted_histogram(
+                    histograms[index - tile_begin],
+                    weight_histograms[index - tile_begin],
+                    total_weight
+                );
+            }
+        }
+        if (on_tile_done) {
+            on_tile_done(tile_begin, tile_end, stats_vec);
+        }
+
+        if (g_profiling_enabled) {
+            ThreadProfile& profile = get_thread_profile();
+            profile.loop_items += tile_guesses.size();
+            profile.loop_busy_cycles += read_cycle_counter() - tile_start;
+        }
+        num_done += tile_guesses.size();
+        if (
+            show_progress
+            && !(print_lockish++)
+        ) {
+            std::cout << "\rChecked " << num_done << " of " << guess_indexes.size()
+                << "    " << std::flush;
+            print_lockish = 0;
+        }
+    });
+
+    if (g_profiling_enabled) {
+        record_parallel_loop(guess_indexes.size(), read_cycle_counter() - loop_start);
+    }
+
+    if (cancel_flag != nullptr && *cancel_flag) {
+        return {};
+    }
 
-    // guess_index is signed to make omp happy
+    if (show_progress) {
+        std::cout << "\rChecked " << guess_indexes.size() << " of " << guess_indexes.size()
+            << "    " << std::endl;
+    }
+    return stats_vec;
+}
+
+std::vector<ResponseHistogram> get_response_histograms(
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers
+) {
+    std::vector<ResponseHistogram> histograms(possible_guesses.size());
+    const ScoringTileSizes sizes = tile_sizes;
+    const int64_t num_guess_tiles = (
+        (possible_guesses.size() + sizes.num_guesses - 1) / sizes.num_guesses
+    );
+
+    // tile_index is signed to make omp happy
     #pragma omp parallel for schedule(dynamic)
-    for (int64_t guess_index = 0; guess_index < possible_guesses.size(); guess_index++) {
-        get_remaining_answers(
-            possible_guesses[guess_index],
+    for (int64_t tile_index = 0; tile_index < num_guess_tiles; tile_index++) {
+        std::size_t tile_begin = tile_index * sizes.num_guesses;
+        std::size_t tile_end = std::min(tile_begin + sizes.num_guesses, possible_guesses.size());
+        std::vector<WordArray> tile_guesses(
+            possible_guesses.begin() + tile_begin,
+            possible_guesses.begin() + tile_end
+        );
+        std::vector<ResponseHistogram> tile_histograms(tile_guesses.size());
+        add_response_histograms(
+            tile_guesses,
+            possible_answers,
+            0,
+            possible_answers.size(),
+            sizes,
+            tile_histograms
+        );
+        std::copy(tile_histograms.begin(), tile_histograms.end(), histograms.begin() + tile_begin);
+    }
+    return histograms;
+}
+
+std::vector<RankedGuess> rank_guesses(
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers,
+    const WordRestriction& restriction,
+    const std::vector<GuessStats>& guess_index_to_stats
+) {
+    std::vector<std::size_t> sorted_guess_indexes(possible_guesses.size());
+    std::iota(sorted_guess_indexes.begin(), sorted_guess_indexes.end(), 0);
+
+    {
+        ProfileTimer timer(PROFILE_SORT);
+        std::sort(
+            sorted_guess_indexes.begin(),
+            sorted_guess_indexes.end(),
+            [&](std::size_t guess_index1, std::size_t guess_index2) {
+                return guess_comparitor(
+                    guess_index_to_stats[guess_index1].mean,
+                    guess_index_to_stats[guess_index1].median,
+                    guess_index_to_stats[guess_index2].mean,
+                    guess_index_to_stats[guess_index2].median,
+                    possible_guesses[guess_index1],
+                    possible_guesses[guess_index2],
+                    restriction
+                );
+            }
+        );
+    }
+
+    // Sorted copy so that the "in remaining answer list" check isn't a linear search
+    std::vector<WordArray> sorted_answers = possible_answers;
+    std::sort(sorted_answers.begin(), sorted_answers.end());
+
+    std::vector<RankedGuess> ranked_guesses;
+    ranked_guesses.reserve(possible_guesses.size());
+    for (auto guess_index : sorted_guess_indexes) {
+        RankedGuess ranked_guess;
+        ranked_guess.guess = possible_guesses[guess_index];
+        ranked_guess.stats = guess_index_to_stats[guess_index];
+        ranked_guess.is_un_eliminated = restriction.is_word_allowed(ranked_guess.guess);
+        ranked_guess.is_in_answer_list = std::binary_search(
+            sorted_answers.begin(),
+            sorted_answers.end(),
+            ranked_guess.guess
+        );
+        ranked_guesses.push_back(ranked_guess);
+    }
+    return ranked_guesses;
+}
+
+std::vector<RankedGuess> get_ranked_guesses(
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers,
+    const WordRestriction& restriction,
+    const std::atomic_bool* cancel_flag,
+    bool show_progress
+) {
+    std::vector<std::size_t> guess_indexes(possible_guesses.size());
+    std::iota(guess_indexes.begin(), guess_indexes.end(), 0);
+
+    std::vector<GuessStats> guess_index_to_stats = get_guess_stats(
+        possible_guesses,
+        possible_answers,
+        guess_indexes,
+        cancel_flag,
+        show_progress
+    );
+    if (cancel_flag != nullptr && *cancel_flag) {
+        return {};
+    }
+    return rank_guesses(possible_guesses, possible_answers, restriction, guess_index_to_stats);
+}
+
+// Per position letter counts over the answers. Cheap (one pass over the answers),
+// and enough to guess roughly how good every guess is before scoring any of them.
+struct LetterHistograms {
+    std::array<std::array<uint32_t, ALPHABET_LENGTH>, WORD_LENGTH> position_to_letter_count = {};
+    std::array<uint32_t, ALPHABET_LENGTH> letter_to_num_containing = {};
+};
+
+static LetterHistograms get_letter_histograms(const std::vector<WordArray>& possible_answers) {
+    LetterHistograms histograms;
+    for (const auto& answer : possible_answers) {
+        LetterMask letters_in_answer = NO_LETTERS;
+        for (uletter_int index = 0; index < WORD_LENGTH; index++) {
+            histograms.position_to_letter_count[index][answer[index]]++;
+            letters_in_answer |= CHAR_FLAGS[answer[index]];
+        }
+        for (uletter_int letter = 0; letter < ALPHABET_LENGTH; letter++) {
+            if (has_letter(letters_in_answer, letter)) {
+                histograms.letter_to_num_containing[letter]++;
+            }
+        }
+    }
+    return histograms;
+}
+
+struct GuessEstimate {
+    // What the sum of squared bucket sizes would be if each position's color
+    // were independent of the others. Only used to decide what to score first.
+    double sum_of_squares = 0;
+    // Upper bound on how many different responses the guess can get. Position i
+    // can only be green if some answer has that letter there, only yellow if some
+    // answer has it somewhere else, and only gray if some answer doesn't have it there.
+    uint32_t max_num_buckets = NUM_RESPONSES;
+};
+
+static GuessEstimate estimate_guess(
+    const WordArray& guess,
+    const LetterHistograms& histograms,
+    std::size_t num_answers
+) {
+    GuessEstimate estimate;
+    double fraction_product = 1;
+    uint64_t max_num_buckets = 1;
+    for (uletter_int index = 0; index < WORD_LENGTH; index++) {
+        double num_green = histograms.position_to_letter_count[index][guess[index]];
+        double num_elsewhere = histograms.letter_to_num_containing[guess[index]] - num_green;
+        double num_gray = num_answers - num_green - num_elsewhere;
+        fraction_product *= (
+            (num_green * num_green + num_elsewhere * num_elsewhere + num_gray * num_gray)
+            / ((double) num_answers * num_answers)
+        );
+        max_num_buckets *= (num_green > 0) + (num_elsewhere > 0) + (num_green < num_answers);
+    }
+    estimate.sum_of_squares = fraction_product * num_answers * num_answers;
+    estimate.max_num_buckets = std::min<uint64_t>(max_num_buckets, NUM_RESPONSES);
+    return estimate;
+}
+
+// Median and mean of the num_wanted-th best guess scored so far. Packed into one
+// word so both halves are always read together.
+class PruningThreshold {
+public:
+    explicit PruningThreshold(std::size_t num_wanted) : num_wanted(num_wanted) {}
+
+    void add(const GuessStats& stats) {
+        std::lock_guard<std::mutex> lock(mutex);
+        best_keys.push({stats.median, stats.mean});
+        if (best_keys.size() > num_wanted) {
+            best_keys.pop();
+        }
+        if (best_keys.size() == num_wanted) {
+            uint32_t median_bits, mean_bits;
+            std::memcpy(&median_bits, &best_keys.top().first, sizeof(median_bits));
+            std::memcpy(&mean_bits, &best_keys.top().second, sizeof(mean_bits));
+            packed = ((uint64_t) median_bits << 32) | mean_bits;
+        }
+    }
+
+    // False until num_wanted guesses have been added
+    bool get(float& median, float& mean) const {
+        uint64_t packed_copy = packed;
+        if (packed_copy == NOT_SET) {
+            return false;
+        }
+        uint32_t median_bits = packed_copy >> 32;
+        uint32_t mean_bits = packed_copy & 0xffffffff;
+        std::memcpy(&median, &median_bits, sizeof(median));
+        std::memcpy(&mean, &mean_bits, sizeof(mean));
+        return true;
+    }
+
+private:
+    static constexpr uint64_t NOT_SET = UINT64_MAX;
+    std::size_t num_wanted;
+    std::mutex mutex;
+    std::priority_queue<std::pair<float, float>> best_keys;  // worst on top
+    std::atomic<uint64_t> packed = NOT_SET;
+};
+
+// True if, however the answers after the first num_seen turn out, the guess
+// with this (partial) histogram will sort after one with threshold_median and
+// threshold_mean. Every answer's final bucket is at least as big as it is now,
+// and there are at most max_num_buckets buckets to spread the rest over.
+static bool is_certainly_worse(
+    const ResponseHistogram& histogram,
+    std::size_t num_seen,
+    std::size_t num_answers,
+    uint32_t max_num_buckets,
+    float threshold_median,
+    float threshold_mean
+) {
+    // Lower of the two middle answers if there's an even number
+    const uint64_t median_index = (num_answers - 1) / 2;
+
+    // Upper bound on how many answers can end up in buckets smaller than value
+    auto get_max_num_below = [&](uint64_t value) {
+        uint64_t num_nonempty = 0;
+        uint64_t num_small_buckets = 0;
+        uint64_t num_in_big_buckets = 0;
+        for (auto bucket_size : histogram) {
+            num_nonempty += bucket_size > 0;
+            if (bucket_size >= value) {
+                num_in_big_buckets += bucket_size;
+            } else if (bucket_size > 0) {
+                num_small_buckets++;
+            }
+        }
+        num_small_buckets += std::max<uint64_t>(max_num_buckets, num_nonempty) - num_nonempty;
+        return std::min<uint64_t>(num_small_buckets * (value - 1), num_answers - num_in_big_buckets);
+    };
+    auto median_is_at_least = [&](uint64_t value) {
+        return get_max_num_below(value) <= median_index;
+    };
+
+    // Medians are whole or half numbers, so this means strictly worse
+    uint64_t threshold_floor = (uint64_t) std::floor(threshold_median);
+    if (median_is_at_least(threshold_floor + 1)) {
+        return true;
+    }
+    if (threshold_floor != threshold_median || !median_is_at_least(threshold_floor)) {
+        return false;
+    }
+
+    // Same median at best, so it comes down to the mean. Each answer still to
+    // come adds at least 1 to the sum of squares.
+    uint64_t sum_of_squares = num_answers - num_seen;
+    for (auto bucket_size : histogram) {
+        sum_of_squares += (uint64_t) bucket_size * bucket_size;
+    }
+    uint64_t num_answers_squared = (uint64_t) num_answers * num_answers;
+    sum_of_squares = std::max<uint64_t>(
+        sum_of_squares,
+        (num_answers_squared + max_num_buckets - 1) / max_num_buckets
+    );
+    return float_is_less_than(threshold_mean, (float) sum_of_squares / num_answers);
+}
+
+// is_certainly_worse, for weighted answers. A bucket only ever gains weight as
+// answers come in, so the weight already in buckets of at least some size stays
+// in buckets that big, and each answer still to come adds at least its own
+// weight (a bucket of 1) to the mean.
+static bool is_certainly_worse_weighted(
+    const ResponseHistogram& histogram,
+    const WeightHistogram& weight_histogram,
+    float total_weight,
+    float threshold_median,
+    float threshold_mean
+) {
+    auto median_is_at_least = [&](uint64_t value) {
+        double max_weight_below = total_weight;
+        for (std::size_t response_index = 0; response_index < NUM_RESPONSES; response_index++) {
+            if (histogram[response_index] >= value) {
+                max_weight_below -= weight_histogram[response_index];
+            }
+        }
+        return max_weight_below < total_weight * (0.5 - WEIGHT_SLACK);
+    };
+
+    // Weighted medians are always whole, but the threshold might not be
+    uint64_t threshold_floor = (uint64_t) std::floor(threshold_median);
+    if (median_is_at_least(threshold_floor + 1)) {
+        return true;
+    }
+    if (threshold_floor != threshold_median || !median_is_at_least(threshold_floor)) {
+        return false;
+    }
+
+    double weight_seen = 0;
+    double weighted_size_sum = 0;
+    for (std::size_t response_index = 0; response_index < NUM_RESPONSES; response_index++) {
+        weight_seen += weight_histogram[response_index];
+        weighted_size_sum += (double) weight_histogram[response_index] * histogram[response_index];
+    }
+    weighted_size_sum += std::max(0.0, total_weight - weight_seen);
+    return float_is_less_than(threshold_mean, (float) (weighted_size_sum / total_weight));
+}
+
+std::vector<RankedGuess> get_top_ranked_guesses(
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers,
+    const WordRestriction& restriction,
+    std::size_t num_wanted,
+    const std::atomic_bool* cancel_flag,
+    bool show_progress,
+    PruningStats* pruning_stats,
+    TopGuessesSoFar* so_far
+) {
+    if (so_far != nullptr) {
+        so_far->start(possible_guesses.size());
+    }
+    if (
+        num_wanted == 0
+        || possible_answers.empty()
+        || num_wanted >= possible_guesses.size()
+    ) {
+        std::vector<RankedGuess> ranked_guesses = get_ranked_guesses(
+            possible_guesses,
             possible_answers,
             restriction,
-            guess_index_to_answer_index_to_num_remaining[guess_index],
-            means[guess_index],
-            medians[guess_index],
-            stddevs[guess_index]
+            cancel_flag,
+            show_progress
         );
-        num_done++;
+        if (so_far != nullptr) {
+            for (const auto& ranked_guess : ranked_guesses) {
+                so_far->add_scored(ranked_guess);
+            }
+        }
+        ranked_guesses.resize(std::min(num_wanted, ranked_guesses.size()));
+        return ranked_guesses;
+    }
+    auto should_stop = [&]() {
+        return (
+            (cancel_flag != nullptr && *cancel_flag)
+            || (so_far != nullptr && so_far->is_stop_requested())
+        );
+    };
+
+    const WeightArray answer_weights = get_answer_weights(possible_answers);
+    const float total_weight = std::accumulate(answer_weights.begin(), answer_weights.end(), 0.0f);
+
+    const std::size_t num_answers = possible_answers.size();
+    std::vector<GuessEstimate> guess_index_to_estimate(possible_guesses.size());
+    {
+        ProfileTimer timer(PROFILE_SCORE);
+        LetterHistograms letter_histograms = get_letter_histograms(possible_answers);
+        for (std::size_t guess_index = 0; guess_index < possible_guesses.size(); guess_index++) {
+            guess_index_to_estimate[guess_index] = estimate_guess(
+                possible_guesses[guess_index],
+                letter_histograms,
+                num_answers
+            );
+        }
+    }
+
+    // Likely good guesses first, so the threshold gets tight early
+    std::vector<std::size_t> guess_order(possible_guesses.size());
+    std::iota(guess_order.begin(), guess_order.end(), 0);
+    {
+        ProfileTimer timer(PROFILE_SORT);
+        std::stable_sort(
+            guess_order.begin(),
+            guess_order.end(),
+            [&](std::size_t guess_index1, std::size_t guess_index2) {
+                return (
+                    guess_index_to_estimate[guess_index1].sum_of_squares
+                    < guess_index_to_estimate[guess_index2].sum_of_squares
+                );
+            }
+        );
+    }
+
+    PruningThreshold threshold(num_wanted);
+    std::vector<GuessStats> guess_index_to_stats(possible_guesses.size());
+    std::vector<char> guess_index_to_is_scored(possible_guesses.size(), false);
+    std::atomic<uint64_t> num_pruned = 0;
+    std::atomic<uint64_t> num_responses = 0;
+
+    // For so_far's "in remaining answer list" column
+    std::vector<WordArray> sorted_answers;
+    if (so_far != nullptr) {
+        sorted_answers = possible_answers;
+        std::sort(sorted_answers.begin(), sorted_answers.end());
+    }
+
+    std::atomic_uint32_t num_done = 0;
+    std::atomic_uint32_t print_lockish = 0;
+    if (show_progress) {
+        std::cout << "\nChecked 0 of " << possible_guesses.size() << "    " << std::flush;
+    }
+
+    const ScoringTileSizes sizes = tile_sizes;
+    const std::size_t answers_between_checks = std::max(
+        num_answers / NUM_PRUNING_CHECKS,
+        MIN_ANSWERS_BETWEEN_PRUNING_CHECKS
+    );
+    const int64_t num_guess_tiles = (
+        (guess_order.size() + sizes.num_guesses - 1) / sizes.num_guesses
+    );
+    const auto answer_replicas = get_node_replicas(possible_answers);
+    const auto weight_replicas = get_node_replicas(answer_weights);
+    uint64_t loop_start = g_profiling_enabled ? read_cycle_counter() : 0;
+
+    for_each_tile_by_node(num_guess_tiles, [&](int64_t tile_index, std::size_t node_index) {
+        if (should_stop()) {
+            return;
+        }
+        const std::vector<WordArray>& node_answers = answer_replicas->get(node_index);
+        const WeightArray& node_weights = weight_replicas->get(node_index);
+        uint64_t tile_start = g_profiling_enabled ? read_cycle_counter() : 0;
+        std::size_t tile_begin = tile_index * sizes.num_guesses;
+        std::size_t tile_end = std::min(tile_begin + sizes.num_guesses, guess_order.size());
+
+        // Guesses in this tile that haven't been pruned yet
+        std::vector<std::size_t> live_guess_indexes(
+            guess_order.begin() + tile_begin,
+            guess_order.begin() + tile_end
+        );
+        std::vector<WordArray> live_guesses;
+        for (auto guess_index : live_guess_indexes) {
+            live_guesses.push_back(possible_guesses[guess_index]);
+        }
+        std::vector<ResponseHistogram> histograms(live_guesses.size());
+        std::vector<WeightHistogram> weight_histograms(answer_weights.empty() ? 0 : live_guesses.size());
+
+        std::size_t answers_begin = 0;
+        for (
+            ;
+            answers_begin < num_answers && !live_guesses.empty();
+            answers_begin += answers_between_checks
+        ) {
+            if (answers_begin > 0 && should_stop()) {
+                break;
+            }
+            std::size_t answers_end = std::min(answers_begin + answers_between_checks, num_answers);
+            add_response_histograms(
+                live_guesses,
+                node_answers,
+                answers_begin,
+                answers_end,
+                sizes,
+                histograms,
+                answer_weights.empty() ? nullptr : node_weights.data(),
+                &weight_histograms
+            );
+            num_responses += live_guesses.size() * (answers_end - answers_begin);
+
+            // Until over half the answers are in, the other half could all be in
+            // buckets of 1 as far as the bounds know, so there's no point checking
+            float threshold_median, threshold_mean;
+            if (
+                answers_end <= num_answers / 2
+                || answers_end == num_answers
+                || !threshold.get(threshold_median, threshold_mean)
+            ) {
+                continue;
+            }
+            std::size_t num_kept = 0;
+            for (std::size_t live_index = 0; live_index < live_guesses.size(); live_index++) {
+                if (
+                    answer_weights.empty()
+                    ? is_certainly_worse(
+                        histograms[live_index],
+                        answers_end,
+                        num_answers,
+                        guess_index_to_estimate[live_guess_indexes[live_index]].max_num_buckets,
+                        threshold_median,
+                        threshold_mean
+                    )
+                    : is_certainly_worse_weighted(
+                        histograms[live_index],
+                        weight_histograms[live_index],
+                        total_weight,
+                        threshold_median,
+                        threshold_mean
+                    )
+                ) {
+                    num_pruned++;
+                    if (so_far != nullptr) {
+                        so_far->add_pruned();
+                    }
+                    continue;
+                }
+                live_guess_indexes[num_kept] = live_guess_indexes[live_index];
+                live_guesses[num_kept] = live_guesses[live_index];
+                histograms[num_kept] = histograms[live_index];
+                if (!answer_weights.empty()) {
+                    weight_histograms[num_kept] = weight_histograms[live_index];
+                }
+                num_kept++;
+            }
+            live_guess_indexes.resize(num_kept);
+            live_guesses.resize(num_kept);
+            histograms.resize(num_kept);
+            if (!answer_weights.empty()) {
+                weight_histograms.resize(num_kept);
+            }
+        }
+        // Stopped part way through the answers, so the rest don't count as scored
+        if (answers_begin < num_answers && !live_guesses.empty()) {
+            return;
+        }
+
+        for (std::size_t live_index = 0; live_index < live_guesses.size(); live_index++) {
+            std::size_t guess_index = live_guess_indexes[live_index];
+            if (answer_weights.empty()) {
+                guess_index_to_stats[guess_index] = get_stats_from_histogram(
+                    histograms[live_index],
+                    num_answers
+                );
+            } else {
+                guess_index_to_stats[guess_index] = get_stats_from_weighted_histogram(
+                    histograms[live_index],
+                    weight_histograms[live_index],
+                    total_weight
+                );
+            }
+            guess_index_to_is_scored[guess_index] = true;
+            threshold.add(guess_index_to_stats[guess_index]);
+            if (so_far != nullptr) {
+                RankedGuess ranked_guess;
+                ranked_guess.guess = live_guesses[live_index];
+                ranked_guess.stats = guess_index_to_stats[guess_index];
+                ranked_guess.is_un_eliminated = restriction.is_word_allowed(ranked_guess.guess);
+                ranked_guess.is_in_answer_list = std::binary_search(
+                    sorted_answers.begin(),
+                    sorted_answers.end(),
+                    ranked_guess.guess
+                );
+                so_far->add_scored(ranked_guess);
+            }
+        }
+
+        if (g_profiling_enabled) {
+            ThreadProfile& profile = get_thread_profile();
+            profile.loop_items += tile_end - tile_begin;
+            profile.loop_busy_cycles += read_cycle_counter() - tile_start;
+        }
+        num_done += tile_end - tile_begin;
         if (
-            !(num_done & 0xf) &&
-            !(print_lockish++)
+            show_progress
+            && !(print_lockish++)
         ) {
             std::cout << "\rChecked " << num_done << " of " << possible_guesses.size()
                 << "    " << std::flush;
             print_lockish = 0;
         }
+    });
+
+    if (g_profiling_enabled) {
+        record_parallel_loop(possible_guesses.size(), read_cycle_counter() - loop_start);
     }
 
-    std::cout << "\rChecked " << possible_guesses.size() << " of " << possible_guesses.size()
-        << "    " << std::endl;
+    if (cancel_flag != nullptr && *cancel_flag) {
+        return {};
+    }
 
-    std::vector<std::size_t> sorted_guess_indexes(possible_guesses.size());
-    std::iota(sorted_guess_indexes.begin(), sorted_guess_indexes.end(), 0);
+    if (pruning_stats != nullptr) {
+        pruning_stats->num_guesses = possible_guesses.size();
+        pruning_stats->num_pruned = num_pruned;
+        pruning_stats->num_responses = num_responses;
+        pruning_stats->num_exhaustive_responses = (uint64_t) possible_guesses.size() * num_answers;
+    }
+    if (show_progress) {
+        std::cout << "\rChecked " << num_done << " of " << possible_guesses.size()
+            << "    " << std::endl;
+        std::cout << "Pruned " << num_pruned << " of " << possible_guesses.size()
+            << " guesses early, scored " << std::fixed << std::setprecision(1)
+            << 100.0 * num_responses / ((double) possible_guesses.size() * num_answers)
+            << "% of guess/answer pairs" << std::endl;
+    }
 
-    std::sort(
-        sorted_guess_indexes.begin(),
-        sorted_guess_indexes.end(),
-        [&](std::size_t guess_index1, std::size_t guess_index2) {
-            return guess_comparitor(
-                means[guess_index1],
-                medians[guess_index1],
-                means[guess_index2],
-                medians[guess_index2],
-                possible_guesses[guess_index1],
-                possible_guesses[guess_index2],
-                restriction
-            );
+    std::vector<WordArray> scored_guesses;
+    std::vector<GuessStats> scored_stats;
+    for (std::size_t guess_index = 0; guess_index < possible_guesses.size(); guess_index++) {
+        if (guess_index_to_is_scored[guess_index]) {
+            scored_guesses.push_back(possible_guesses[guess_index]);
+            scored_stats.push_back(guess_index_to_stats[guess_index]);
         }
+    }
+    std::vector<RankedGuess> ranked_guesses = rank_guesses(
+        scored_guesses,
+        possible_answers,
+        restriction,
+        scored_stats
     );
+    ranked_guesses.resize(std::min(num_wanted, ranked_guesses.size()));
+    return ranked_guesses;
+}
 
+void print_ranked_guesses(const std::vector<RankedGuess>& ranked_guesses) {
+    ProfileTimer timer(PROFILE_IO);
     std::size_t num_printed = 0;
+    const bool is_weighted = has_answer_weights();
     std::cout
         << "SUGGESTED ANSWERS (sorted by decreasing ~remaining answers):\n"
-        << "   Word | Median  | Mean    | StdDev  |\n"
-        << "  -------------------------------------\n";
-    for (auto guess_index : sorted_guess_indexes) {
-        std::cout << "  " << word_vec_to_string(possible_guesses[guess_index]) << " | "
+        << "   Word | Median  | Mean    | StdDev  |"
+        << (is_weighted ? " Entropy | P(win)  |" : "") << "\n"
+        << "  -------------------------------------"
+        << (is_weighted ? "-------------------" : "") << "\n";
+    for (const auto& ranked_guess : ranked_guesses) {
+        std::cout << "  " << word_vec_to_string(ranked_guess.guess) << " | "
             << std::fixed << std::setprecision(2)
-            << std::setw(7) << medians[guess_index] << " | "
-            << std::setw(7) << means[guess_index]   << " | "
-            << std::setw(7) << stddevs[guess_index] << " |"
-            << (
-                restriction.is_word_allowed(possible_guesses[guess_index])
-                ? " (un-eliminated)" : ""
-            )
-            // TODO: This is stupid inefficient, but it also probably won't matter.
-            //       But maybe make it better anyway, out of principle.
-            << (
-                std::find(
-                    possible_answers.begin(),
-                    possible_answers.end(),
-                    possible_guesses[guess_index]
-                ) != possible_answers.end()
-                ? " (in remaining answer list)": ""
-            )
+            << std::setw(7) << ranked_guess.stats.median << " | "
+            << std::setw(7) << ranked_guess.stats.mean   << " | "
+            << std::setw(7) << ranked_guess.stats.stddev << " |";
+        if (is_weighted) {
+            std::cout << " " << std::setw(7) << ranked_guess.stats.entropy << " | "
+                << std::setprecision(4) << std::setw(7) << ranked_guess.stats.win_probability << " |";
+        }
+        std::cout
+            << (ranked_guess.is_un_eliminated ? " (un-eliminated)" : "")
+            << (ranked_guess.is_in_answer_list ? " (in remaining answer list)": "")
             << std::endl;
         num_printed++;
-        if (num_printed > 35) break;
+        if (num_printed >= NUM_SUGGESTIONS_TO_PRINT) break;
     }
 }
+
+void print_suggestions(
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers,
+    const WordRestriction& restriction
+) {
+    print_ranked_guesses(
+        get_top_ranked_guesses(
+            possible_guesses,
+            possible_answers,
+            restriction,
+            NUM_SUGGESTIONS_TO_PRINT
+        )
+    );
+}
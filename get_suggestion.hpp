@@ -2,21 +2,305 @@
 #define get_suggestion_hpp
 
 #include <vector>
+#include <array>
 #include <string>
 #include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <new>
+#include <cstddef>
 
 #include "word_restriction.hpp"
+#include "response_code.hpp"
 #include "common.hpp"
 
+// With answer weights (see set_answer_weights), mean/median/stddev are of the
+// number of answers left, with each answer counted by its weight instead of 1,
+// and the last two are filled in too.
+struct GuessStats {
+    float mean = 0;
+    float median = 0;
+    float stddev = 0;
+    float entropy = 0;          // bits, of which response comes back
+    float win_probability = 0;  // chance the guess is the answer
+};
+
+// One row of the suggestion table, self contained so that it can be computed
+// ahead of time (see speculation.hpp) and printed later.
+struct RankedGuess {
+    WordArray guess;
+    GuessStats stats;
+    bool is_un_eliminated = false;
+    bool is_in_answer_list = false;
+};
+
+// Guesses x answers are scored in tiles of this many of each
+struct ScoringTileSizes {
+    std::size_t num_guesses = 16;
+    std::size_t num_answers = 1024;
+};
+
+ScoringTileSizes get_tile_sizes();
+void set_tile_sizes(const ScoringTileSizes& sizes);
+
+// Times a few tile sizes on a sample of the guesses and keeps the fastest.
+// Meant to be run once at startup, with the biggest lists that will be scored.
+ScoringTileSizes autotune_tile_sizes(
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers
+);
+
+// std::vector storage that starts on a cache line, for float arrays that are
+// walked in step with the answer list
+template <typename T, std::size_t ALIGNMENT = 64>
+struct AlignedAllocator {
+    typedef T value_type;
+    template <typename U> struct rebind { typedef AlignedAllocator<U, ALIGNMENT> other; };
+
+    AlignedAllocator() = default;
+    template <typename U> AlignedAllocator(const AlignedAllocator<U, ALIGNMENT>&) {}
+
+    T* allocate(std::size_t num) {
+        return static_cast<T*>(::operator new(num * sizeof(T), std::align_val_t(ALIGNMENT)));
+    }
+    void deallocate(T* pointer, std::size_t) {
+        ::operator delete(pointer, std::align_val_t(ALIGNMENT));
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, ALIGNMENT>&) const { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, ALIGNMENT>&) const { return false; }
+};
+
+typedef std::vector<float, AlignedAllocator<float>> WeightArray;
+
+// Optional prior on the answers, eg word frequencies (they don't have to add up
+// to 1). Set once at startup, before any scoring. Once set, every answer list
+// that gets scored is looked up in it, and answers that aren't in it count as 0.
+// An empty words list turns weighting back off.
+void set_answer_weights(const std::vector<WordArray>& words, const std::vector<float>& weights);
+bool has_answer_weights();
+
+// Weight of each of possible_answers, in the same order. Empty if there are no
+// answer weights, or if they add up to 0 over possible_answers (in which case
+// scoring falls back to counting every answer the same).
+WeightArray get_answer_weights(const std::vector<WordArray>& possible_answers);
+
+// Called with positions [begin, end) of guess_indexes as soon as their stats
+// are done, from whichever thread did them (so it has to be thread safe).
+typedef std::function<
+    void(std::size_t begin, std::size_t end, const std::vector<GuessStats>& stats_vec)
+> TileDoneCallback;
+
+// Scores possible_guesses[guess_indexes[i]] into element i of the result. If
+// cancel_flag is set while this is running, returns an empty vector.
+std::vector<GuessStats> get_guess_stats(
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers,
+    const std::vector<std::size_t>& guess_indexes,
+    const std::atomic_bool* cancel_flag = nullptr,
+    bool show_progress = true,
+    const TileDoneCallback& on_tile_done = nullptr
+);
+
+// How many answers get each response, indexed by ResponseCode
+typedef std::array<uint32_t, NUM_RESPONSES> ResponseHistogram;
+
+// Each guess's histogram over every answer. For keeping and patching as the
+// answers change (see dictionary.hpp) - scoring doesn't hold on to these.
+std::vector<ResponseHistogram> get_response_histograms(
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers
+);
+
+// Every answer that gets the same response as the real answer is left after the
+// guess, so each answer contributes its bucket's size. This gives exactly the same
+// numbers as updating a restriction per answer and counting what it allows, as
+// long as every possible answer is allowed by the current restriction. Unweighted.
+GuessStats get_stats_from_histogram(
+    const ResponseHistogram& histogram,
+    std::size_t num_answers
+);
+
+// The same, from the sizes of just the nonempty buckets, in any order (they're
+// sorted in place). For buckets that aren't one guess's responses, eg the
+// answers that get the same responses to two guesses.
+GuessStats get_stats_from_bucket_sizes(
+    uint32_t* bucket_sizes,
+    std::size_t num_buckets,
+    std::size_t num_answers
+);
+
+// True if stats1 ranks before stats2 on median and then mean, the way
+// rank_guesses sorts. Scores that are the same up to float rounding are neither.
+bool is_better_score(const GuessStats& stats1, const GuessStats& stats2);
+
+// Sorts all of possible_guesses, best first, given the stats for each
+std::vector<RankedGuess> rank_guesses(
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers,
+    const WordRestriction& restriction,
+    const std::vector<GuessStats>& guess_index_to_stats
+);
+
+// Returns every guess, best first. Every possible answer must be allowed by
+// restriction. If cancel_flag is set while this is running,
+// the remaining work is skipped and an empty vector is returned.
+std::vector<RankedGuess> get_ranked_guesses(
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers,
+    const WordRestriction& restriction,
+    const std::atomic_bool* cancel_flag = nullptr,
+    bool show_progress = true
+);
+
+// How many rows print_ranked_guesses shows
+constexpr std::size_t NUM_SUGGESTIONS_TO_PRINT = 36;
+
+struct PruningStats {
+    std::size_t num_guesses = 0;
+    std::size_t num_pruned = 0;     // dropped before every answer was scored
+    uint64_t num_responses = 0;     // guess/answer pairs actually scored
+    uint64_t num_exhaustive_responses = 0;
+};
+
+// How far a get_top_ranked_guesses call has gotten. Guesses that are neither
+// scored nor pruned haven't been looked at (or were only part way done).
+struct TopGuessesCoverage {
+    std::size_t num_guesses = 0;
+    std::size_t num_scored = 0;  // against every answer
+    std::size_t num_pruned = 0;  // shown to be out of the top num_wanted
+
+    bool is_complete() const {
+        return num_scored + num_pruned == num_guesses;
+    }
+};
+
+// The best guesses a get_top_ranked_guesses call has found so far, readable
+// while it's still running. Also how to stop it early: unlike cancel_flag,
+// request_stop keeps what's been done, and the call returns the best of that.
+// Thread safe.
+class TopGuessesSoFar {
+public:
+    explicit TopGuessesSoFar(std::size_t num_wanted) : num_wanted(num_wanted) {}
+
+    // Best first, at most num_wanted of them
+    std::vector<RankedGuess> get_ranked_guesses() const;
+    TopGuessesCoverage get_coverage() const;
+
+    // Workers finish the chunk of answers they're on, then skip everything else
+    void request_stop();
+    bool is_stop_requested() const;
+
+    // For get_top_ranked_guesses
+    void start(std::size_t num_guesses);
+    void add_scored(const RankedGuess& ranked_guess);
+    void add_pruned();
+
+private:
+    const std::size_t num_wanted;
+    mutable std::mutex mutex;
+    std::vector<RankedGuess> best;  // best first
+    std::atomic<std::size_t> num_guesses = 0;
+    std::atomic<std::size_t> num_scored = 0;
+    std::atomic<std::size_t> num_pruned = 0;
+    std::atomic_bool stop_requested = false;
+};
+
+// Exactly the first num_wanted of what get_ranked_guesses would return, but
+// usually much faster. Guesses are scored in order of a cheap estimate from per
+// position letter counts, and a guess is dropped part way through its answers
+// once bounds on its final median/mean show it can't beat the num_wanted-th best
+// guess found so far. Only guesses that are certainly worse are dropped, so the
+// result doesn't depend on the estimate or on thread timing. With answer
+// weights, the bounds are on the weighted median/mean instead.
+//
+// If so_far is given, every guess goes into it as soon as it's scored, and
+// once its stop is requested the result is only the best of what got scored.
+std::vector<RankedGuess> get_top_ranked_guesses(
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers,
+    const WordRestriction& restriction,
+    std::size_t num_wanted,
+    const std::atomic_bool* cancel_flag = nullptr,
+    bool show_progress = true,
+    PruningStats* pruning_stats = nullptr,
+    TopGuessesSoFar* so_far = nullptr
+);
+
+void print_ranked_guesses(const std::vector<RankedGuess>& ranked_guesses);
+
 void print_suggestions(
     const std::vector<WordArray>& possible_guesses,
     const std::vector<WordArray>& possible_answers,
     const WordRestriction& restriction
 );
 
+// For use as an index into per-response counts (eg when splitting answers into
+// buckets by response). Same thing as the ResponseCode, see response_code.hpp.
+inline uint32_t response_to_index(const ResponseArray& response) {
+    return response_array_to_code(response);
+}
+
 inline ResponseArray calculate_response(
     const WordArray& guess,
     const WordArray& answer
-);
+){
+    ResponseArray response = EMPTY_RESPONSE;
+    AlphabetArray letter_count = EMPTY_ALPHABET_ARRAY;
+    AlphabetArray letter_to_green_count = EMPTY_ALPHABET_ARRAY;
+
+    for (uletter_int index = 0; index < WORD_LENGTH; index++) {
+        if (answer[index] == guess[index]) {
+            response[index] = 2;
+            letter_to_green_count[answer[index]] += 1;
+        }
+        letter_count[answer[index]]++;
+    }
+
+    for (uletter_int index = 0; index < WORD_LENGTH; index++) {
+        if (
+            guess[index] != answer[index]
+            && letter_count[guess[index]] > letter_to_green_count[guess[index]]
+        ) {
+            response[index] = 1;
+            letter_count[guess[index]]--;
+        }
+    }
+
+    return response;
+}
+
+// Same as response_to_index(calculate_response(guess, answer)), without the
+// array in between. Answer letters that are green are left out of the counts
+// up front, instead of being counted and then compared against the greens.
+inline ResponseCode calculate_response_code(
+    const WordArray& guess,
+    const WordArray& answer
+){
+    ResponseCode response_code = 0;
+    AlphabetArray letter_count = EMPTY_ALPHABET_ARRAY;
+    uint32_t green_positions = 0;
+
+    for (uletter_int index = 0; index < WORD_LENGTH; index++) {
+        if (answer[index] == guess[index]) {
+            response_code += 2 * RESPONSE_PLACE_VALUES[index];
+            green_positions |= 1 << index;
+        } else {
+            letter_count[answer[index]]++;
+        }
+    }
+
+    for (uletter_int index = 0; index < WORD_LENGTH; index++) {
+        if (!(green_positions & (1 << index)) && letter_count[guess[index]]) {
+            response_code += RESPONSE_PLACE_VALUES[index];
+            letter_count[guess[index]]--;
+        }
+    }
+
+    return response_code;
+}
 
-#endif
\ No newline at end of file
+#endif
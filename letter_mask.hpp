@@ -0,0 +1,169 @@
+#ifndef letter_mask_hpp
+#define letter_mask_hpp
+
+#include <array>
+#include <bit>
+#include <type_traits>
+#include <stdint.h>
+
+#include "common.hpp"
+
+// A set of letters, one bit per letter (bit i is letter i). As narrow as
+// ALPHABET_LENGTH allows: a plain uint32_t or uint64_t, where everything is a
+// single instruction, and past 64 letters, two uint64_ts with the same
+// operators (which compilers keep in a 128 bit register anyway). Code using
+// masks should stick to the operators and helpers below rather than shifting
+// by letter, so it works with all three.
+
+struct WideLetterMask {
+    uint64_t low = 0;
+    uint64_t high = 0;
+
+    constexpr WideLetterMask() = default;
+    constexpr WideLetterMask(uint64_t low, uint64_t high) : low(low), high(high) {}
+
+    constexpr WideLetterMask operator&(const WideLetterMask& other) const {
+        return {low & other.low, high & other.high};
+    }
+    constexpr WideLetterMask operator|(const WideLetterMask& other) const {
+        return {low | other.low, high | other.high};
+    }
+    constexpr WideLetterMask operator^(const WideLetterMask& other) const {
+        return {low ^ other.low, high ^ other.high};
+    }
+    constexpr WideLetterMask operator~() const {
+        return {~low, ~high};
+    }
+    constexpr WideLetterMask& operator&=(const WideLetterMask& other) {
+        return *this = *this & other;
+    }
+    constexpr WideLetterMask& operator|=(const WideLetterMask& other) {
+        return *this = *this | other;
+    }
+    constexpr WideLetterMask& operator^=(const WideLetterMask& other) {
+        return *this = *this ^ other;
+    }
+    constexpr bool operator==(const WideLetterMask& other) const {
+        return low == other.low && high == other.high;
+    }
+    constexpr bool operator!=(const WideLetterMask& other) const {
+        return !(*this == other);
+    }
+    constexpr explicit operator bool() const {
+        return (low | high) != 0;
+    }
+};
+
+typedef std::conditional_t<
+    ALPHABET_LENGTH <= 32,
+    uint32_t,
+    std::conditional_t<ALPHABET_LENGTH <= 64, uint64_t, WideLetterMask>
+> LetterMask;
+
+constexpr LetterMask NO_LETTERS = {};
+
+// The helpers are templates only so that the if constexpr branch for the
+// other kind of mask is thrown away instead of compiled
+template <typename Mask = LetterMask>
+constexpr Mask get_letter_flag(uletter_int letter) {
+    if constexpr (std::is_same_v<Mask, WideLetterMask>) {
+        return letter < 64
+            ? WideLetterMask(uint64_t(1) << letter, 0)
+            : WideLetterMask(0, uint64_t(1) << (letter - 64));
+    } else {
+        return Mask(1) << letter;
+    }
+}
+
+constexpr std::array<LetterMask, ALPHABET_LENGTH> make_char_flags() {
+    std::array<LetterMask, ALPHABET_LENGTH> char_flags = {};
+    for (uletter_int letter = 0; letter < ALPHABET_LENGTH; letter++) {
+        char_flags[letter] = get_letter_flag(letter);
+    }
+    return char_flags;
+}
+
+constexpr LetterMask make_any_char() {
+    LetterMask any_char = NO_LETTERS;
+    for (uletter_int letter = 0; letter < ALPHABET_LENGTH; letter++) {
+        any_char |= get_letter_flag(letter);
+    }
+    return any_char;
+}
+
+// CHAR_FLAGS[letter] has just that letter's bit set, ANY_CHAR every letter's
+constexpr std::array<LetterMask, ALPHABET_LENGTH> CHAR_FLAGS = make_char_flags();
+constexpr LetterMask ANY_CHAR = make_any_char();
+
+// 1 if letter is in mask, else 0. A uint32_t, since a uletter_int here stops
+// the loops over letters in word_restriction.cpp from vectorizing.
+template <typename Mask>
+inline uint32_t get_letter_bit(const Mask& mask, uletter_int letter) {
+    if constexpr (std::is_same_v<Mask, WideLetterMask>) {
+        return (uint32_t) (letter < 64 ? (mask.low >> letter) & 1 : (mask.high >> (letter - 64)) & 1);
+    } else {
+        return (mask >> letter) & 1;
+    }
+}
+
+template <typename Mask>
+inline bool has_letter(const Mask& mask, uletter_int letter) {
+    return get_letter_bit(mask, letter);
+}
+
+// CHAR_FLAGS[letter] if condition, else nothing - without a branch
+template <typename Mask = LetterMask>
+inline Mask letter_flag_if(bool condition, uletter_int letter) {
+    if constexpr (std::is_same_v<Mask, WideLetterMask>) {
+        const uint64_t all_if = ~(uint64_t) condition + 1;
+        return get_letter_flag<Mask>(letter) & WideLetterMask(all_if, all_if);
+    } else {
+        return Mask(condition) << letter;
+    }
+}
+
+template <typename Mask>
+inline uletter_int count_letters(const Mask& mask) {
+    if constexpr (std::is_same_v<Mask, WideLetterMask>) {
+        return std::popcount(mask.low) + std::popcount(mask.high);
+    } else {
+        return std::popcount(mask);
+    }
+}
+
+// Only for masks with something in them
+template <typename Mask>
+inline uletter_int get_lowest_letter(const Mask& mask) {
+    if constexpr (std::is_same_v<Mask, WideLetterMask>) {
+        return mask.low ? std::countr_zero(mask.low) : 64 + std::countr_zero(mask.high);
+    } else {
+        return std::countr_zero(mask);
+    }
+}
+
+// CHAR_FLAGS[get_lowest_letter(mask)], without the lookup
+template <typename Mask>
+inline Mask get_lowest_letter_flag(const Mask& mask) {
+    if constexpr (std::is_same_v<Mask, WideLetterMask>) {
+        return mask.low
+            ? WideLetterMask(mask.low & (~mask.low + 1), 0)
+            : WideLetterMask(0, mask.high & (~mask.high + 1));
+    } else {
+        return mask & (~mask + 1);
+    }
+}
+
+// For going through the letters in a mask:
+// for (LetterMask remaining = mask; remaining != NO_LETTERS; remaining = without_lowest_letter(remaining))
+template <typename Mask>
+inline Mask without_lowest_letter(const Mask& mask) {
+    if constexpr (std::is_same_v<Mask, WideLetterMask>) {
+        return mask.low
+            ? WideLetterMask(mask.low & (mask.low - 1), mask.high)
+            : WideLetterMask(0, mask.high & (mask.high - 1));
+    } else {
+        return mask & (mask - 1);
+    }
+}
+
+#endif
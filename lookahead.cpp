@@ -0,0 +1,209 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <array>
+#include <atomic>
+#include <algorithm>
+
+#include "lookahead.hpp"
+#include "get_suggestion.hpp"
+#include "task_scheduler.hpp"
+#include "profiler.hpp"
+#include "common.hpp"
+
+// Number of follow up guesses scored by a single task
+static constexpr std::size_t FOLLOW_UP_CHUNK_SIZE = 256;
+
+// Buckets where (answers x follow ups) is smaller than this are scored by one
+// task - splitting them up would cost more than it saves.
+static constexpr std::size_t MIN_SPLIT_BUCKET_WORK = 1 << 16;
+
+// Sum of (size of part)^2 over the parts that guess splits answers into. Divided
+// by answers.size(), that's the expected number of answers left after guess.
+static uint64_t get_sum_of_squared_bucket_sizes(
+    const WordArray& guess,
+    const std::vector<WordArray>& answers
+) {
+    std::array<uint32_t, NUM_RESPONSES> response_counts = {};
+    uint64_t sum_of_squares = 0;
+    for (const auto& answer : answers) {
+        uint32_t& count = response_counts[calculate_response_code(guess, answer)];
+        // (n + 1)^2 = n^2 + 2n + 1
+        sum_of_squares += 2 * count + 1;
+        count++;
+    }
+    return sum_of_squares;
+}
+
+static void lower_to(std::atomic<uint64_t>& best, uint64_t value) {
+    uint64_t current = best;
+    while (value < current && !best.compare_exchange_weak(current, value)) {}
+}
+
+// Scores follow_ups[begin, end) against bucket_answers, lowering best. Gives up
+// early once nothing can beat best (every answer in its own part).
+static void score_follow_ups(
+    const std::vector<WordArray>& follow_ups,
+    std::size_t begin,
+    std::size_t end,
+    const std::vector<WordArray>& bucket_answers,
+    std::atomic<uint64_t>& best,
+    TaskGroup* group
+) {
+    ProfileTimer timer(PROFILE_SCORE);
+    const uint64_t perfect_score = bucket_answers.size();
+    for (std::size_t follow_up_index = begin; follow_up_index < end; follow_up_index++) {
+        if (best <= perfect_score || (group != nullptr && group->is_cancelled())) {
+            return;
+        }
+        lower_to(
+            best,
+            get_sum_of_squared_bucket_sizes(follow_ups[follow_up_index], bucket_answers)
+        );
+    }
+    if (best <= perfect_score && group != nullptr) {
+        group->cancel();
+    }
+}
+
+static LookaheadGuess score_two_guesses(
+    const WordArray& guess,
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers,
+    TaskScheduler& scheduler,
+    const std::atomic_bool* cancel_flag,
+    bool is_hard_mode
+) {
+    // Indexed by response
+    std::vector<std::vector<WordArray>> buckets(NUM_RESPONSES);
+    for (const auto& answer : possible_answers) {
+        buckets[calculate_response_code(guess, answer)].push_back(answer);
+    }
+
+    // In hard mode the follow up has to fit what guess revealed, ie it has to be
+    // a word that would have got the same response if it were the answer
+    std::vector<std::vector<WordArray>> response_to_follow_ups;
+    if (is_hard_mode) {
+        response_to_follow_ups.resize(NUM_RESPONSES);
+        for (const auto& follow_up : possible_guesses) {
+            response_to_follow_ups[
+                calculate_response_code(guess, follow_up)
+            ].push_back(follow_up);
+        }
+    }
+
+    // Start from "the follow up tells us nothing"
+    std::vector<std::atomic<uint64_t>> bucket_to_best(buckets.size());
+    uint64_t one_guess_sum = 0;
+    for (std::size_t bucket_index = 0; bucket_index < buckets.size(); bucket_index++) {
+        uint64_t bucket_size = buckets[bucket_index].size();
+        bucket_to_best[bucket_index] = bucket_size * bucket_size;
+        one_guess_sum += bucket_size * bucket_size;
+    }
+
+    TaskGroup bucket_group(scheduler, cancel_flag);
+    for (std::size_t bucket_index = 0; bucket_index < buckets.size(); bucket_index++) {
+        const auto& bucket_answers = buckets[bucket_index];
+        const auto& follow_ups = is_hard_mode ? response_to_follow_ups[bucket_index] : possible_guesses;
+        auto& best = bucket_to_best[bucket_index];
+        if (bucket_answers.size() <= 1) {
+            continue;
+        }
+
+        if (bucket_answers.size() * follow_ups.size() < MIN_SPLIT_BUCKET_WORK) {
+            bucket_group.run([&]() {
+                score_follow_ups(follow_ups, 0, follow_ups.size(), bucket_answers, best, nullptr);
+            });
+            continue;
+        }
+
+        bucket_group.run([&]() {
+            TaskGroup chunk_group(scheduler, cancel_flag);
+            for (
+                std::size_t begin = 0;
+                begin < follow_ups.size();
+                begin += FOLLOW_UP_CHUNK_SIZE
+            ) {
+                std::size_t end = std::min(begin + FOLLOW_UP_CHUNK_SIZE, follow_ups.size());
+                chunk_group.run([&, begin, end]() {
+                    score_follow_ups(follow_ups, begin, end, bucket_answers, best, &chunk_group);
+                });
+            }
+            chunk_group.wait();
+        });
+    }
+    bucket_group.wait();
+
+    uint64_t two_guess_sum = 0;
+    for (const auto& best : bucket_to_best) {
+        two_guess_sum += best;
+    }
+
+    LookaheadGuess result;
+    result.guess = guess;
+    result.one_guess_mean = (float) one_guess_sum / possible_answers.size();
+    result.two_guess_mean = (float) two_guess_sum / possible_answers.size();
+    return result;
+}
+
+std::vector<LookaheadGuess> get_lookahead_ranking(
+    const std::vector<RankedGuess>& ranked_guesses,
+    std::size_t num_candidates,
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers,
+    TaskScheduler& scheduler,
+    const std::atomic_bool* cancel_flag,
+    bool is_hard_mode
+) {
+    num_candidates = std::min(num_candidates, ranked_guesses.size());
+    if (possible_answers.empty()) {
+        return {};
+    }
+    std::vector<LookaheadGuess> lookahead_guesses(num_candidates);
+
+    TaskGroup guess_group(scheduler, cancel_flag);
+    for (std::size_t candidate_index = 0; candidate_index < num_candidates; candidate_index++) {
+        guess_group.run([&, candidate_index]() {
+            lookahead_guesses[candidate_index] = score_two_guesses(
+                ranked_guesses[candidate_index].guess,
+                possible_guesses,
+                possible_answers,
+                scheduler,
+                cancel_flag,
+                is_hard_mode
+            );
+        });
+    }
+    guess_group.wait();
+
+    if (cancel_flag != nullptr && *cancel_flag) {
+        return {};
+    }
+
+    std::stable_sort(
+        lookahead_guesses.begin(),
+        lookahead_guesses.end(),
+        [](const LookaheadGuess& guess1, const LookaheadGuess& guess2) {
+            if (guess1.two_guess_mean != guess2.two_guess_mean) {
+                return guess1.two_guess_mean < guess2.two_guess_mean;
+            }
+            return guess1.one_guess_mean < guess2.one_guess_mean;
+        }
+    );
+    return lookahead_guesses;
+}
+
+void print_lookahead_ranking(const std::vector<LookaheadGuess>& lookahead_guesses) {
+    ProfileTimer timer(PROFILE_IO);
+    std::cout
+        << "\nTWO GUESS LOOKAHEAD (expected remaining answers, best follow up per response):\n"
+        << "   Word | 1 Guess | 2 Guesses |\n"
+        << "  ------------------------------\n";
+    for (const auto& lookahead_guess : lookahead_guesses) {
+        std::cout << "  " << word_vec_to_string(lookahead_guess.guess) << " | "
+            << std::fixed << std::setprecision(2)
+            << std::setw(7) << lookahead_guess.one_guess_mean << " | "
+            << std::setw(9) << lookahead_guess.two_guess_mean << " |"
+            << std::endl;
+    }
+}
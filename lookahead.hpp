@@ -0,0 +1,35 @@
+#ifndef lookahead_hpp
+#define lookahead_hpp
+
+#include <vector>
+#include <atomic>
+
+#include "get_suggestion.hpp"
+#include "task_scheduler.hpp"
+#include "common.hpp"
+
+struct LookaheadGuess {
+    WordArray guess;
+    float one_guess_mean = 0;   // expected remaining answers after this guess
+    float two_guess_mean = 0;   // same, after this guess and the best follow up to its response
+};
+
+// Scores the first num_candidates of ranked_guesses two guesses deep: for each
+// candidate, each response it could get, and each possible follow up guess.
+// Subproblem sizes vary wildly (a response shared by 500 answers vs by 2), so
+// this is split into nested tasks on the work stealing scheduler rather than one
+// flat omp loop. Sorted best first; empty if cancel_flag gets set. In hard mode
+// each follow up is only picked from the guesses that fit the candidate's response.
+std::vector<LookaheadGuess> get_lookahead_ranking(
+    const std::vector<RankedGuess>& ranked_guesses,
+    std::size_t num_candidates,
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers,
+    TaskScheduler& scheduler,
+    const std::atomic_bool* cancel_flag = nullptr,
+    bool is_hard_mode = false
+);
+
+void print_lookahead_ranking(const std::vector<LookaheadGuess>& lookahead_guesses);
+
+#endif
@@ -6,25 +6,57 @@
 #include <string>
 #include <stdexcept>
 #include <unordered_set>
+#include <memory>
+#include <optional>
+#include <numeric>
+#include <cmath>
+#include <chrono>
 
 #include "word_restriction.hpp"
+#include "response_code.hpp"
 #include "get_suggestion.hpp"
+#include "speculation.hpp"
+#include "lookahead.hpp"
+#include "task_scheduler.hpp"
+#include "partial_results.hpp"
+#include "checkpoint.hpp"
+#include "word_table.hpp"
+#include "word_trie.hpp"
+#include "profiler.hpp"
+#include "numa.hpp"
+#include "anytime.hpp"
+#include "dictionary.hpp"
+#include "verify.hpp"
+#include "opening_pair.hpp"
+#include "alphabet.hpp"
 #include "common.hpp"
 
 const std::string ALL_GUESSES_FILENAME = "words_14855_from_wordle_source.txt";
 const std::string ALL_ANSWERS_FILENAME = "words_2310_from_wordle_source_simple.txt";
+// Fixed so that a --verify failure can be reproduced
+const uint32_t VERIFY_NUM_RANDOM_GAMES = 2000;
+const uint32_t VERIFY_SEED = 12345;
 
 static inline WordArray string_to_word_arr(const std::string& word) {
-    WordArray word_vec;
-    uletter_int index = 0;
-    for (auto c : word) {
-        word_vec[index] = c - 'a';
-        index++;
+    WordArray word_arr;
+    if (!get_alphabet().to_word(word, word_arr)) {
+        throw std::invalid_argument("Not a word in this alphabet: " + word);
     }
-    return word_vec;
+    return word_arr;
 }
 
-std::vector<std::string> get_words_from_file(const std::string& filename) {
+// If weights_dest is given, lines can have a second column with a weight for
+// that word (eg how common it is). Either every word has one or none do - if
+// none do, weights_dest is left empty. Words are UTF-8: a-z, plus whatever
+// non-ascii letters the alphabet ends up with (see alphabet.hpp). Lines with
+// ascii non-letters are skipped, but a word with a non-ascii character that
+// isn't a letter (eg a curly quote) is an error, since that would otherwise
+// quietly become a letter of the alphabet.
+std::vector<std::string> get_words_from_file(
+    const std::string& filename,
+    std::vector<float>* weights_dest = nullptr
+) {
+    ProfileTimer timer(PROFILE_IO);
     std::fstream fin(filename, std::ios::in);
 
     if (!fin.is_open()) {
@@ -34,29 +66,40 @@ std::vector<std::string> get_words_from_file(const std::string& filename) {
 
     std::vector<std::string> words;
     std::unordered_set<std::string> seen_words;
+    std::vector<std::string> characters;
     std::string line;
+    std::size_t line_number = 0;
     while (std::getline(fin, line)) {
+        line_number++;
         if (line.size() < WORD_LENGTH) continue;
 
-        // must be ascii
-        if (std::any_of(line.begin(), line.end(), [](unsigned char c) {return c > 127; })) {
-            continue;
-        }
-
         std::size_t first = 0;
         std::size_t last = line.size() - 1;
         for (; first < line.size(); first++) {
-            if (!std::isspace(line[first])) break;
+            if (!std::isspace((unsigned char) line[first])) break;
         }
         for (; last > 0; last--) {
-            if (!std::isspace(line[last])) break;
+            if (!std::isspace((unsigned char) line[last])) break;
         }
 
-        // Wrong length
-        if (
-            last < first
-            || last - first + 1 != WORD_LENGTH
-        ) {
+        // Split off a weight column, if that's wanted
+        std::string weight_str;
+        if (weights_dest != nullptr && first <= last) {
+            std::size_t word_end = first;
+            while (word_end <= last && !std::isspace((unsigned char) line[word_end])) {
+                word_end++;
+            }
+            if (word_end <= last) {
+                std::size_t weight_begin = word_end;
+                while (std::isspace((unsigned char) line[weight_begin])) {
+                    weight_begin++;
+                }
+                weight_str = line.substr(weight_begin, last - weight_begin + 1);
+                last = word_end - 1;
+            }
+        }
+
+        if (last < first) {
             continue;
         }
 
@@ -64,26 +107,57 @@ std::vector<std::string> get_words_from_file(const std::string& filename) {
         line = line.substr(first, last - first + 1);
 
         // Lowercaseify
-        std::transform(
-            line.begin(),
-            line.end(),
-            line.begin(),
-            [](unsigned char c) { return std::tolower(c); }
-        );
+        line = to_lower_case(line);
+
+        // Wrong length, or not UTF-8
+        if (!split_characters(line, characters) || characters.size() != WORD_LENGTH) {
+            continue;
+        }
 
         // Must be letters
         if (std::any_of(
                 line.begin(),
                 line.end(),
-                [](unsigned char c) {return c > 'z' || c < 'a'; }
+                [](unsigned char c) {return c < 128 && (c > 'z' || c < 'a'); }
         )){
             continue;
         }
+        for (const auto& character : characters) {
+            if (character.size() > 1 && !is_letter_character(character)) {
+                throw std::runtime_error(
+                    filename + ":" + std::to_string(line_number) + ": \"" + character
+                    + "\" in " + line + " isn't a letter"
+                );
+            }
+        }
 
         if (seen_words.find(line) != seen_words.end()) {
             continue;
         }
 
+        if (weights_dest != nullptr) {
+            float weight = -1;
+            std::size_t num_parsed = 0;
+            if (!weight_str.empty()) {
+                try {
+                    weight = std::stof(weight_str, &num_parsed);
+                } catch (const std::exception&) {}
+            }
+            if (!words.empty() && weight_str.empty() != weights_dest->empty()) {
+                throw std::runtime_error(
+                    filename + ": some words have weights and some don't (at " + line + ")"
+                );
+            }
+            if (!weight_str.empty()) {
+                if (num_parsed != weight_str.size() || !std::isfinite(weight) || weight < 0) {
+                    throw std::runtime_error(
+                        filename + ": bad weight \"" + weight_str + "\" for " + line
+                    );
+                }
+                weights_dest->push_back(weight);
+            }
+        }
+
         // Finally, it's a word.
         words.push_back(line);
         seen_words.insert(line);
@@ -91,68 +165,68 @@ std::vector<std::string> get_words_from_file(const std::string& filename) {
     return words;
 }
 
-std::vector<WordArray> convert_words(const std::vector<std::string>& words_as_strings) {
-    std::vector<WordArray> converted_words(
-        words_as_strings.size()
-    );
+// Words using characters that didn't fit in the alphabet are left out, along
+// with their weights if weights is given (and not empty)
+std::vector<WordArray> convert_words(
+    const std::vector<std::string>& words_as_strings,
+    std::vector<float>* weights = nullptr
+) {
+    const Alphabet& alphabet = get_alphabet();
+    const bool has_weights = weights != nullptr && !weights->empty();
+    std::vector<WordArray> converted_words;
+    std::vector<float> kept_weights;
+    converted_words.reserve(words_as_strings.size());
 
-    std::size_t word_index = 0;
-    for (const std::string& word : words_as_strings) {
-        for (std::size_t letter_index = 0; letter_index < WORD_LENGTH; letter_index++) {
-            converted_words[word_index][letter_index] = word[letter_index] - 'a';
+    std::size_t num_skipped = 0;
+    for (std::size_t word_index = 0; word_index < words_as_strings.size(); word_index++) {
+        WordArray word;
+        if (!alphabet.to_word(words_as_strings[word_index], word)) {
+            num_skipped++;
+            continue;
+        }
+        converted_words.push_back(word);
+        if (has_weights) {
+            kept_weights.push_back((*weights)[word_index]);
         }
-        word_index++;
+    }
+    if (has_weights) {
+        *weights = std::move(kept_weights);
+    }
+    if (num_skipped > 0) {
+        std::cerr << "Skipped " << num_skipped << " words with letters past the first "
+            << (int) ALPHABET_LENGTH << " (build with a bigger WORDLE_ALPHABET_LENGTH for them)"
+            << std::endl;
     }
 
     return converted_words;
 }
 
-ResponseArray get_response_from_user() {
+ResponseCode get_response_from_user() {
     std::string user_input;
+    ResponseCode response_code;
     while (true) {
         std::cout << "Enter response (2: green, 1: yellow, 0: gray): " << std::flush;
         std::getline(std::cin, user_input);
-        if (
-            user_input.size() == WORD_LENGTH
-            && std::all_of(
-                user_input.begin(),
-                user_input.end(),
-                [](char c) {return c >= '0' && c <= '2'; }
-            )
-        ) {
-            break;
+        if (parse_response_code(user_input, response_code)) {
+            return response_code;
         }
         std::cout << "BAD INPUT." << std::endl;
     }
-
-    ResponseArray response;
-    uletter_int index = 0;
-    for (auto c : user_input) {
-        response[index] = c - '0';
-        index++;
-    }
-    return response;
 }
 
 WordArray get_word_from_user() {
     std::string user_input;
+    WordArray word;
     while (true) {
-        std::cout << "Enter word (all lowercase, length "<< (int) WORD_LENGTH << "): " << std::flush;
+        std::cout << "Enter word (length "<< (int) WORD_LENGTH << "): " << std::flush;
         std::getline(std::cin, user_input);
-        if (
-            user_input.size() == WORD_LENGTH
-            && std::all_of(
-                user_input.begin(),
-                user_input.end(),
-                [](char c) {return c >= 'a' && c <= 'z'; }
-            )
-            ) {
+        if (get_alphabet().to_word(user_input, word)) {
             break;
         }
         std::cout << "BAD INPUT." << std::endl;
     }
 
-    return string_to_word_arr(user_input);
+    return word;
 }
 
 int get_user_action() {
@@ -182,7 +256,8 @@ int get_user_action() {
 int test(
     std::vector<WordArray>& possible_answers,
     std::vector<WordArray>& possible_guesses,
-    WordRestriction& restriction
+    WordRestriction& restriction,
+    bool is_hard_mode
 ) {
     auto answer = string_to_word_arr("piano");
     auto guess1 = string_to_word_arr("tares");
@@ -214,8 +289,13 @@ int test(
         std::vector<WordArray> new_possible_guesses;
         new_possible_guesses.reserve(possible_guesses.size());
         for (auto& guess : possible_guesses) {
-            if (restriction.can_provide_new_information(guess))
+            if (
+                is_hard_mode
+                ? restriction.is_word_allowed(guess)
+                : restriction.can_provide_new_information(guess)
+            ) {
                 new_possible_guesses.push_back(std::move(guess));
+            }
         }
         possible_guesses = std::move(new_possible_guesses);
         std::cout << std::endl;
@@ -234,9 +314,29 @@ class CommandLineParser {
 public:
     bool recieved_help_arg = false;
     bool do_test = false;
+    bool do_verify = false;
     bool do_big_search = false;
-    const std::string* guesses_file_p = nullptr;
-    const std::string* answers_file_p = nullptr;
+    bool do_opening_pair = false;
+    bool do_speculate = false;
+    bool do_profile = false;
+    std::size_t num_lookahead_candidates = 0;
+    uint32_t deadline_ms = 0;  // 0 for no deadline
+    bool do_refine = false;
+    bool do_watch = false;
+    bool do_shard = false;
+    uint32_t shard_index = 0;
+    uint32_t num_shards = 1;
+    std::string shard_file;
+    std::vector<std::string> merge_files;
+    std::string checkpoint_file;
+    bool do_resume = false;
+    bool do_exhaustive = false;
+    bool is_hard_mode = false;
+    bool use_trie = false;
+    bool use_numa = false;
+    std::string profile_json_file;
+    std::string guesses_file;
+    std::string answers_file;
 
     CommandLineParser() = default;
     CommandLineParser(int argc, char** argv) {
@@ -246,22 +346,103 @@ public:
                 return;
             } else if (std::string("--guesses-list") == argv[arg_i]) {
                 arg_i++;
-                if (guesses_file_p != nullptr) {
+                if (!guesses_file.empty()) {
                     throw std::invalid_argument("File supplied twice");
                 }
-                guesses_file_p = new std::string(argv[arg_i]);
+                guesses_file = argv[arg_i];
 
             } else if (std::string("--answers-list") == argv[arg_i]) {
                 arg_i++;
-                if (answers_file_p != nullptr) {
+                if (!answers_file.empty()) {
                     throw std::invalid_argument("File supplied twice");
                 }
-                answers_file_p = new std::string(argv[arg_i]);
+                answers_file = argv[arg_i];
 
             } else if (std::string("--test") == argv[arg_i]) {
                 do_test = true;
+            } else if (std::string("--verify") == argv[arg_i]) {
+                do_verify = true;
             } else if (std::string("--search") == argv[arg_i]) {
                 do_big_search = true;
+            } else if (std::string("--opening-pair") == argv[arg_i]) {
+                do_opening_pair = true;
+            } else if (std::string("--speculate") == argv[arg_i]) {
+                do_speculate = true;
+            } else if (std::string("--lookahead") == argv[arg_i]) {
+                arg_i++;
+                if (arg_i >= argc) {
+                    throw std::invalid_argument("--lookahead requires a number of guesses");
+                }
+                num_lookahead_candidates = std::stoul(argv[arg_i]);
+            } else if (std::string("--deadline-ms") == argv[arg_i]) {
+                arg_i++;
+                if (arg_i >= argc) {
+                    throw std::invalid_argument("--deadline-ms requires a number of milliseconds");
+                }
+                deadline_ms = std::stoul(argv[arg_i]);
+                if (deadline_ms == 0) {
+                    throw std::invalid_argument("--deadline-ms has to be at least 1");
+                }
+            } else if (std::string("--refine") == argv[arg_i]) {
+                do_refine = true;
+            } else if (std::string("--watch") == argv[arg_i]) {
+                do_watch = true;
+            } else if (std::string("--shard") == argv[arg_i]) {
+                arg_i++;
+                if (arg_i >= argc) {
+                    throw std::invalid_argument("--shard requires i/N");
+                }
+                std::string shard_arg = argv[arg_i];
+                std::size_t slash_pos = shard_arg.find('/');
+                if (slash_pos == std::string::npos) {
+                    throw std::invalid_argument("--shard must look like i/N, eg 0/4");
+                }
+                shard_index = std::stoul(shard_arg.substr(0, slash_pos));
+                num_shards = std::stoul(shard_arg.substr(slash_pos + 1));
+                if (num_shards == 0 || shard_index >= num_shards) {
+                    throw std::invalid_argument("--shard i/N needs 0 <= i < N");
+                }
+                do_shard = true;
+            } else if (std::string("--shard-file") == argv[arg_i]) {
+                arg_i++;
+                if (arg_i >= argc) {
+                    throw std::invalid_argument("--shard-file requires a filename");
+                }
+                shard_file = argv[arg_i];
+            } else if (std::string("--merge") == argv[arg_i]) {
+                // Takes every filename up to the next --option
+                while (arg_i + 1 < argc && std::string(argv[arg_i + 1]).rfind("--", 0) != 0) {
+                    arg_i++;
+                    merge_files.push_back(argv[arg_i]);
+                }
+                if (merge_files.empty()) {
+                    throw std::invalid_argument("--merge requires at least one file");
+                }
+            } else if (std::string("--checkpoint") == argv[arg_i]) {
+                arg_i++;
+                if (arg_i >= argc) {
+                    throw std::invalid_argument("--checkpoint requires a filename");
+                }
+                checkpoint_file = argv[arg_i];
+            } else if (std::string("--resume") == argv[arg_i]) {
+                do_resume = true;
+            } else if (std::string("--exhaustive") == argv[arg_i]) {
+                do_exhaustive = true;
+            } else if (std::string("--hard") == argv[arg_i]) {
+                is_hard_mode = true;
+            } else if (std::string("--trie") == argv[arg_i]) {
+                use_trie = true;
+            } else if (std::string("--numa") == argv[arg_i]) {
+                use_numa = true;
+            } else if (std::string("--profile") == argv[arg_i]) {
+                do_profile = true;
+            } else if (std::string("--profile-json") == argv[arg_i]) {
+                arg_i++;
+                if (arg_i >= argc) {
+                    throw std::invalid_argument("--profile-json requires a filename");
+                }
+                do_profile = true;
+                profile_json_file = argv[arg_i];
 
             } else {
                 throw std::invalid_argument(
@@ -273,20 +454,50 @@ public:
         if (do_big_search && do_test) {
             throw std::invalid_argument("Cannot use --test with --search.");
         }
+        if (do_shard + !merge_files.empty() + do_big_search + do_opening_pair + do_test + do_verify > 1) {
+            throw std::invalid_argument(
+                "Use only one of --test, --verify, --search, --opening-pair, --shard and --merge."
+            );
+        }
+        if (do_opening_pair && (is_hard_mode || deadline_ms || num_lookahead_candidates)) {
+            throw std::invalid_argument("--opening-pair doesn't work with --hard, --deadline-ms or --lookahead.");
+        }
+        if (!checkpoint_file.empty() && !do_big_search && !do_shard) {
+            throw std::invalid_argument("--checkpoint only works with --search or --shard.");
+        }
+        if (deadline_ms && (do_exhaustive || do_test || do_verify || do_shard || !merge_files.empty())) {
+            throw std::invalid_argument(
+                "--deadline-ms doesn't work with --exhaustive, --test, --verify, --shard or --merge."
+            );
+        }
+        if (deadline_ms && !checkpoint_file.empty()) {
+            throw std::invalid_argument("--deadline-ms doesn't work with --checkpoint.");
+        }
+        if (do_refine && !deadline_ms) {
+            throw std::invalid_argument("--refine requires --deadline-ms.");
+        }
+        if (
+            do_watch
+            && (do_test || do_verify || do_big_search || do_opening_pair || do_shard || !merge_files.empty())
+        ) {
+            throw std::invalid_argument("--watch only works interactively.");
+        }
+        if (do_resume && checkpoint_file.empty()) {
+            throw std::invalid_argument("--resume requires --checkpoint.");
+        }
+        if (do_shard && shard_file.empty()) {
+            shard_file = (
+                "shard_" + std::to_string(shard_index) + "_of_" + std::to_string(num_shards) + ".bin"
+            );
+        }
 
-        if (guesses_file_p == nullptr) {
-            guesses_file_p = &ALL_GUESSES_FILENAME;
+        if (guesses_file.empty()) {
+            guesses_file = ALL_GUESSES_FILENAME;
         }
-        if (answers_file_p == nullptr) {
-            answers_file_p = &ALL_ANSWERS_FILENAME;
+        if (answers_file.empty()) {
+            answers_file = ALL_ANSWERS_FILENAME;
         }
     }
-    ~CommandLineParser() {
-        if (guesses_file_p != nullptr and guesses_file_p != &ALL_GUESSES_FILENAME)
-            delete guesses_file_p;
-        if (answers_file_p != nullptr and answers_file_p != &ALL_ANSWERS_FILENAME)
-            delete answers_file_p;
-    }
 
     void print_help(const std::string& prog_name) {
         std::cout << "Usage: " << prog_name << "[word_list] [--test] [--help]\n"
@@ -294,14 +505,298 @@ public:
             << "                      Default: pwd/" << ALL_GUESSES_FILENAME << "\n"
             << "    --answers-list  - Filename of answers list to use (one per line).\n"
             << "                      Default: pwd/" << ALL_ANSWERS_FILENAME << "\n"
+            << "                      A second column of weights (eg word frequencies) makes\n"
+            << "                      suggestions weight each answer by how likely it is.\n"
             << "    --search        - Run a non-interactive search for the best starting word.\n"
+            << "    --opening-pair  - Run a non-interactive search for the best pair of\n"
+            << "                      starting words, played whatever the first response.\n"
+            << "                      With --exhaustive, every pair is scored in full.\n"
+            << "    --shard         - i/N: score only slice i of N of the guesses (as --search\n"
+            << "                      would) and write them to --shard-file for --merge.\n"
+            << "    --shard-file    - Where --shard writes its results.\n"
+            << "                      Default: pwd/shard_<i>_of_<N>.bin\n"
+            << "    --merge         - Files written by every --shard i/N, to print the table\n"
+            << "                      --search would have. Needs the same word lists.\n"
+            << "    --checkpoint    - With --search or --shard, log each guess's results to\n"
+            << "                      this file as they finish.\n"
+            << "    --resume        - Skip the guesses already in the --checkpoint file (if it\n"
+            << "                      exists and was made from the same word lists).\n"
+            << "    --exhaustive    - Score every guess against every answer, instead of\n"
+            << "                      dropping guesses that provably can't make the top\n"
+            << "                      of the list. Same output, just slower.\n"
+            << "    --hard          - Hard mode: every guess (including suggestions and the\n"
+            << "                      follow ups in --lookahead) has to fit every hint so far.\n"
+            << "    --trie          - Filter the answers by walking a DAWG of them instead\n"
+            << "                      of checking each word. Meant for very big lists.\n"
+            << "                      Remaining answers are listed alphabetically.\n"
+            << "    --numa          - On multi socket machines: keep a copy of the answers in\n"
+            << "                      each NUMA node's memory, pin scoring threads to CPUs,\n"
+            << "                      and split the guesses between the nodes.\n"
+            << "    --deadline-ms   - Give suggestions after at most about this long, even if\n"
+            << "                      not every guess has been scored yet (most promising\n"
+            << "                      first). Says how many were covered. Default: no limit\n"
+            << "    --refine        - With --deadline-ms, keep scoring in the background after\n"
+            << "                      the deadline, so asking again gives better suggestions.\n"
+            << "    --watch         - Reload the word lists when their files change, patching\n"
+            << "                      the first turn's scores for just the changed words.\n"
+            << "                      Scores every first guess up front to start with.\n"
+            << "    --speculate     - While waiting for a response, precompute the next\n"
+            << "                      turn's suggestions for the most likely responses.\n"
+            << "    --lookahead     - Number of top suggestions to also score two guesses deep\n"
+            << "                      (best follow up for each response). Default: 0\n"
+            << "    --profile       - Print where the time went (per section and per thread)\n"
+            << "                      on exit.\n"
+            << "    --profile-json  - Filename to also write the --profile report to as json.\n"
             << "    --test          - Run a basic non-interactive test.\n"
+            << "    --verify        - Check the fast response and filtering code against the\n"
+            << "                      simple versions (every guess x answer, plus random\n"
+            << "                      games) and print any mismatches and how fast each was.\n"
             << "    --help          - Print this message and exit."
             << std::endl;
     }
 };
 
 
+// The scheduler's threads are only started the first time this is needed
+void print_lookahead(
+    std::size_t num_candidates,
+    const std::vector<RankedGuess>& ranked_guesses,
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers,
+    bool is_hard_mode
+) {
+    if (num_candidates == 0) {
+        return;
+    }
+    static TaskScheduler scheduler;
+    print_lookahead_ranking(
+        get_lookahead_ranking(
+            ranked_guesses,
+            num_candidates,
+            possible_guesses,
+            possible_answers,
+            scheduler,
+            nullptr,
+            is_hard_mode
+        )
+    );
+}
+
+
+// How many of the best guesses have to be ranked exactly (the rest can be pruned)
+std::size_t get_num_ranked_wanted(const CommandLineParser& args) {
+    return std::max(NUM_SUGGESTIONS_TO_PRINT, args.num_lookahead_candidates);
+}
+
+// The best search has by --deadline-ms from now, and how much that covered
+std::vector<RankedGuess> get_anytime_suggestions(
+    const CommandLineParser& args,
+    AnytimeSearch& search,
+    bool keep_refining
+) {
+    auto start = std::chrono::steady_clock::now();
+    AnytimeResult result = search.get_best(
+        start + std::chrono::milliseconds(args.deadline_ms),
+        keep_refining
+    );
+    double milliseconds = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start
+    ).count();
+
+    const TopGuessesCoverage& coverage = result.coverage;
+    std::cout << "\nScored " << coverage.num_scored << " and ruled out " << coverage.num_pruned
+        << " of " << coverage.num_guesses << " guesses in " << (uint64_t) milliseconds << " ms"
+        << (
+            coverage.is_complete()
+            ? " - that's all of them"
+            : (keep_refining ? " - best so far, still refining" : " - best so far")
+        ) << std::endl;
+    return std::move(result.ranked_guesses);
+}
+
+// get_top_ranked_guesses, unless --exhaustive or --deadline-ms
+std::vector<RankedGuess> get_suggestions(
+    const CommandLineParser& args,
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers,
+    const WordRestriction& restriction
+) {
+    if (args.deadline_ms) {
+        AnytimeSearch search(
+            possible_guesses,
+            possible_answers,
+            restriction,
+            get_num_ranked_wanted(args)
+        );
+        return get_anytime_suggestions(args, search, false);
+    }
+    if (args.do_exhaustive) {
+        return get_ranked_guesses(possible_guesses, possible_answers, restriction);
+    }
+    return get_top_ranked_guesses(
+        possible_guesses,
+        possible_answers,
+        restriction,
+        get_num_ranked_wanted(args)
+    );
+}
+
+
+// Answers that fit restriction, from the dictionary's full list
+void filter_answers(
+    const CommandLineParser& args,
+    const Dictionary& dictionary,
+    const WordRestriction& restriction,
+    std::vector<uint32_t>& surviving_answer_indexes,
+    std::vector<WordArray>& possible_answers
+) {
+    if (args.use_trie) {
+        possible_answers = dictionary.answer_trie.get_matching_words(restriction);
+    } else {
+        dictionary.answer_table.get_surviving_indexes(restriction, surviving_answer_indexes);
+        dictionary.answer_table.get_words(surviving_answer_indexes, possible_answers);
+    }
+}
+
+// Guesses still worth making: in hard mode, every guess in the dictionary that
+// fits restriction, and otherwise whichever of from_guesses can still tell us
+// something. In hard mode, surviving_guess_indexes are the guesses that fit an
+// earlier (looser) restriction, and only those get checked - start it off with
+// guess_table.get_all_indexes.
+void filter_guesses(
+    const CommandLineParser& args,
+    const Dictionary& dictionary,
+    const WordRestriction& restriction,
+    std::vector<uint32_t>& surviving_guess_indexes,
+    std::vector<WordArray> from_guesses,
+    std::vector<WordArray>& possible_guesses
+) {
+    if (args.is_hard_mode) {
+        dictionary.guess_table.narrow_surviving_indexes(restriction, surviving_guess_indexes);
+        dictionary.guess_table.get_words(surviving_guess_indexes, possible_guesses);
+        return;
+    }
+
+    // Along the lines of std::remove_if, except that requires nonsense
+    // and almost as much code
+    std::vector<WordArray> new_possible_guesses;
+    new_possible_guesses.reserve(from_guesses.size());
+    for (auto& guess : from_guesses) {
+        if (restriction.can_provide_new_information(guess))
+            new_possible_guesses.push_back(std::move(guess));
+    }
+    possible_guesses = std::move(new_possible_guesses);
+}
+
+// What get_suggestions would say before the first guess, from the opening
+// stats that --watch keeps up to date, without scoring anything
+std::vector<RankedGuess> get_opening_suggestions(
+    const CommandLineParser& args,
+    const Dictionary& dictionary,
+    const WordRestriction& restriction
+) {
+    std::vector<RankedGuess> ranked_guesses = rank_guesses(
+        dictionary.guesses,
+        dictionary.answers,
+        restriction,
+        dictionary.opening_stats
+    );
+    if (!args.do_exhaustive) {
+        ranked_guesses.resize(std::min(get_num_ranked_wanted(args), ranked_guesses.size()));
+    }
+    return ranked_guesses;
+}
+
+void print_dictionary_diff(const Dictionary& dictionary) {
+    const DictionaryDiff& diff = dictionary.diff;
+    auto print_words = [](const char* label, const std::vector<WordArray>& words) {
+        if (words.empty()) return;
+        std::cout << "  " << label << ":";
+        for (const auto& word : words) {
+            std::cout << " " << word_vec_to_string(word);
+        }
+        std::cout << "\n";
+    };
+    std::cout << "\nWord lists changed (version " << dictionary.version << ", patched in "
+        << (uint64_t) (dictionary.build_seconds * 1000) << " ms):\n";
+    print_words("New guesses", diff.added_guesses);
+    print_words("Removed guesses", diff.removed_guesses);
+    print_words("New answers", diff.added_answers);
+    print_words("Removed answers", diff.removed_answers);
+    std::cout << std::flush;
+}
+
+// get_guess_stats, but if --checkpoint was given, skips whatever the checkpoint
+// file already has (with --resume) and logs everything else as it finishes.
+std::vector<GuessStats> get_checkpointed_guess_stats(
+    const CommandLineParser& args,
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers,
+    const std::vector<std::size_t>& guess_indexes
+) {
+    if (args.checkpoint_file.empty()) {
+        return get_guess_stats(possible_guesses, possible_answers, guess_indexes);
+    }
+
+    CheckpointLog checkpoint(
+        args.checkpoint_file,
+        hash_word_lists(possible_guesses, possible_answers),
+        possible_guesses.size(),
+        possible_answers.size(),
+        args.do_resume
+    );
+
+    std::vector<GuessStats> stats_vec(guess_indexes.size());
+    std::vector<bool> is_guess_wanted(possible_guesses.size(), false);
+    std::vector<bool> is_guess_done(possible_guesses.size(), false);
+    std::vector<GuessStats> guess_index_to_stats(possible_guesses.size());
+    for (auto guess_index : guess_indexes) {
+        is_guess_wanted[guess_index] = true;
+    }
+    std::size_t num_resumed = 0;
+    for (const auto& result : checkpoint.get_finished_results()) {
+        if (is_guess_wanted[result.guess_index]) {
+            is_guess_done[result.guess_index] = true;
+            guess_index_to_stats[result.guess_index] = result.stats;
+            num_resumed++;
+        }
+    }
+    if (args.do_resume) {
+        std::cout << "Resumed " << num_resumed << " of " << guess_indexes.size()
+            << " guesses from " << args.checkpoint_file << std::endl;
+    }
+
+    std::vector<std::size_t> remaining_guess_indexes;
+    for (auto guess_index : guess_indexes) {
+        if (!is_guess_done[guess_index]) {
+            remaining_guess_indexes.push_back(guess_index);
+        }
+    }
+    std::vector<GuessStats> remaining_stats = get_guess_stats(
+        possible_guesses,
+        possible_answers,
+        remaining_guess_indexes,
+        nullptr,
+        true,
+        [&](std::size_t begin, std::size_t end, const std::vector<GuessStats>& partial_stats) {
+            std::vector<GuessResult> results;
+            for (std::size_t index = begin; index < end; index++) {
+                results.push_back({(uint32_t) remaining_guess_indexes[index], partial_stats[index]});
+            }
+            checkpoint.append(results);
+        }
+    );
+
+    for (std::size_t index = 0; index < remaining_guess_indexes.size(); index++) {
+        guess_index_to_stats[remaining_guess_indexes[index]] = remaining_stats[index];
+    }
+    for (std::size_t index = 0; index < guess_indexes.size(); index++) {
+        stats_vec[index] = guess_index_to_stats[guess_indexes[index]];
+    }
+    return stats_vec;
+}
+
+
 int main(int argc, char** argv) {
     CommandLineParser args;
     try {
@@ -316,48 +811,325 @@ int main(int argc, char** argv) {
         return 0;
     }
 
-    std::vector<WordArray> possible_guesses = convert_words(
-        get_words_from_file(
-            *args.guesses_file_p
-        )
-    );
-    std::vector<WordArray> possible_answers = convert_words(
-        get_words_from_file(
-            *args.answers_file_p
-        )
-    );
+    ProfileReportGuard profile_report_guard(args.do_profile, args.profile_json_file);
+
+    std::vector<std::string> guess_strings;
+    std::vector<float> answer_weights;
+    std::vector<std::string> answer_strings;
+    try {
+        guess_strings = get_words_from_file(
+            args.guesses_file
+        );
+        answer_strings = get_words_from_file(
+            args.answers_file,
+            &answer_weights
+        );
+    } catch (const std::exception& exc) {
+        std::cerr << exc.what() << std::endl;
+        return 1;
+    }
+
+    // Fixed from here on, so --watch reloads use the same letter numbers
+    std::vector<std::string> all_word_strings = guess_strings;
+    all_word_strings.insert(all_word_strings.end(), answer_strings.begin(), answer_strings.end());
+    set_alphabet(Alphabet::from_words(all_word_strings));
+
+    std::vector<WordArray> possible_guesses = convert_words(guess_strings);
+    std::vector<WordArray> possible_answers = convert_words(answer_strings, &answer_weights);
+    if (!answer_weights.empty()) {
+        // Shard and checkpoint files only keep median/mean/stddev
+        if (
+            args.do_shard || !args.merge_files.empty() || !args.checkpoint_file.empty() || args.do_watch
+            || args.do_opening_pair
+        ) {
+            std::cerr << "Weighted answer lists don't work with --shard, --merge, --checkpoint, --watch"
+                << " or --opening-pair yet"
+                << std::endl;
+            return 1;
+        }
+        set_answer_weights(possible_answers, answer_weights);
+        std::cout << "Using the answer weights from " << args.answers_file << std::endl;
+    }
     WordRestriction restriction;
 
-    if (args.do_test) {
-        return test(possible_answers, possible_guesses, restriction);
-    } else if (args.do_big_search) {
-        print_suggestions(
+    if (args.use_numa) {
+        set_numa_mode(true);
+        const auto& nodes = get_numa_nodes();
+        std::cout << "NUMA nodes:";
+        for (const auto& node : nodes) {
+            std::cout << " " << node.node_id << " (" << node.cpus.size() << " CPUs)";
+        }
+        std::cout << (is_numa_active() ? "" : " - only one, so --numa does nothing") << std::endl;
+    }
+
+    ScoringTileSizes tile_sizes = autotune_tile_sizes(possible_guesses, possible_answers);
+    if (args.do_profile) {
+        std::cout << "Scoring tile sizes: " << tile_sizes.num_guesses << " guesses x "
+            << tile_sizes.num_answers << " answers" << std::endl;
+    }
+
+    if (args.do_verify) {
+        return run_verification(possible_guesses, possible_answers, VERIFY_NUM_RANDOM_GAMES, VERIFY_SEED);
+    } else if (args.do_test) {
+        return test(possible_answers, possible_guesses, restriction, args.is_hard_mode);
+    } else if (args.do_opening_pair) {
+        print_ranked_pairs(
+            get_top_opening_pairs(
+                possible_guesses,
+                possible_answers,
+                NUM_SUGGESTIONS_TO_PRINT,
+                args.do_exhaustive
+            )
+        );
+        return 0;
+    } else if (args.do_big_search && args.checkpoint_file.empty()) {
+        std::vector<RankedGuess> ranked_guesses = get_suggestions(
+            args,
             possible_guesses,
             possible_answers,
             restriction
         );
+        print_ranked_guesses(ranked_guesses);
+        print_lookahead(
+            args.num_lookahead_candidates,
+            ranked_guesses,
+            possible_guesses,
+            possible_answers,
+            args.is_hard_mode
+        );
+        return 0;
+    } else if (args.do_big_search) {
+        // Checkpointed searches score every guess, so that the log is the same
+        // whatever the threshold happened to be when it was killed
+        std::vector<std::size_t> guess_indexes(possible_guesses.size());
+        std::iota(guess_indexes.begin(), guess_indexes.end(), 0);
+        std::vector<GuessStats> guess_index_to_stats;
+        try {
+            guess_index_to_stats = get_checkpointed_guess_stats(
+                args,
+                possible_guesses,
+                possible_answers,
+                guess_indexes
+            );
+        } catch (const std::exception& exc) {
+            std::cerr << exc.what() << std::endl;
+            return 1;
+        }
+        std::vector<RankedGuess> ranked_guesses = rank_guesses(
+            possible_guesses,
+            possible_answers,
+            restriction,
+            guess_index_to_stats
+        );
+        print_ranked_guesses(ranked_guesses);
+        print_lookahead(
+            args.num_lookahead_candidates,
+            ranked_guesses,
+            possible_guesses,
+            possible_answers,
+            args.is_hard_mode
+        );
+        return 0;
+    } else if (args.do_shard) {
+        PartialResults partial_results;
+        partial_results.dictionary_hash = hash_word_lists(possible_guesses, possible_answers);
+        partial_results.shard_index = args.shard_index;
+        partial_results.num_shards = args.num_shards;
+        partial_results.num_guesses = possible_guesses.size();
+        partial_results.num_answers = possible_answers.size();
+
+        std::vector<std::size_t> guess_indexes = get_shard_guess_indexes(
+            possible_guesses.size(),
+            args.shard_index,
+            args.num_shards
+        );
+
+        try {
+            std::vector<GuessStats> stats_vec = get_checkpointed_guess_stats(
+                args,
+                possible_guesses,
+                possible_answers,
+                guess_indexes
+            );
+            for (std::size_t index = 0; index < guess_indexes.size(); index++) {
+                partial_results.results.push_back({(uint32_t) guess_indexes[index], stats_vec[index]});
+            }
+            write_partial_results(args.shard_file, partial_results);
+        } catch (const std::exception& exc) {
+            std::cerr << exc.what() << std::endl;
+            return 1;
+        }
+        std::cout << "Wrote " << partial_results.results.size() << " results to "
+            << args.shard_file << std::endl;
+        return 0;
+    } else if (!args.merge_files.empty()) {
+        std::vector<GuessStats> guess_index_to_stats;
+        try {
+            std::vector<PartialResults> shards;
+            for (const auto& merge_file : args.merge_files) {
+                shards.push_back(read_partial_results(merge_file));
+            }
+            guess_index_to_stats = merge_partial_results(
+                shards,
+                hash_word_lists(possible_guesses, possible_answers),
+                possible_guesses.size()
+            );
+        } catch (const std::exception& exc) {
+            std::cerr << exc.what() << std::endl;
+            return 1;
+        }
+
+        std::vector<RankedGuess> ranked_guesses = rank_guesses(
+            possible_guesses,
+            possible_answers,
+            restriction,
+            guess_index_to_stats
+        );
+        print_ranked_guesses(ranked_guesses);
+        print_lookahead(
+            args.num_lookahead_candidates,
+            ranked_guesses,
+            possible_guesses,
+            possible_answers,
+            args.is_hard_mode
+        );
         return 0;
     }
 
+    // Restrictions only ever get tighter, so filtering the whole answer list
+    // each turn gives the same words as filtering last turn's survivors. Same
+    // for guesses in hard mode, since any guess that's allowed has to fit the
+    // hints. Or with --trie, the same lists as DAWGs.
+    DictionaryOptions dictionary_options;
+    dictionary_options.with_guess_table = args.is_hard_mode;
+    dictionary_options.with_tries = args.use_trie;
+    dictionary_options.with_opening_stats = args.do_watch;
+    std::shared_ptr<const Dictionary> dictionary = build_dictionary(
+        possible_guesses,
+        possible_answers,
+        dictionary_options
+    );
+    std::vector<uint32_t> surviving_answer_indexes;
+    std::vector<uint32_t> surviving_guess_indexes;
+    dictionary->guess_table.get_all_indexes(surviving_guess_indexes);
+    bool is_first_turn = true;
+
+    // Suggestions from possible_guesses for the current state, if already known
+    std::optional<std::vector<RankedGuess>> cached_suggestions;
+    // With --refine, the search for them that carries on between asks
+    std::unique_ptr<AnytimeSearch> refining_search;
+
+    std::unique_ptr<DictionaryWatcher> watcher;
+    if (args.do_watch) {
+        cached_suggestions = get_opening_suggestions(args, *dictionary, restriction);
+        watcher = std::make_unique<DictionaryWatcher>(
+            args.guesses_file,
+            args.answers_file,
+            [](const std::string& filename) {return convert_words(get_words_from_file(filename)); },
+            dictionary
+        );
+        std::cout << "Scored every first guess in " << (uint64_t) (dictionary->build_seconds * 1000)
+            << " ms. Watching " << args.guesses_file << " and "
+            << args.answers_file << " for changes." << std::endl;
+    }
+
     while (true) {
         std::cout << "\nRemaining Solutions: " << possible_answers.size() << "\n" << std::endl;
         int user_action = get_user_action();
+        // After waiting for input, so the action sees whatever changed meanwhile
+        if (watcher) {
+            std::optional<std::string> reload_error = watcher->take_error();
+            if (reload_error.has_value()) {
+                std::cout << *reload_error << std::endl;
+            }
+            std::shared_ptr<const Dictionary> latest = watcher->get_latest();
+            if (latest != dictionary) {
+                dictionary = std::move(latest);
+                print_dictionary_diff(*dictionary);
+                // Indexes into the old table
+                dictionary->guess_table.get_all_indexes(surviving_guess_indexes);
+                refining_search.reset();
+                cached_suggestions.reset();
+                if (is_first_turn) {
+                    possible_answers = dictionary->answers;
+                    possible_guesses = dictionary->guesses;
+                    cached_suggestions = get_opening_suggestions(args, *dictionary, restriction);
+                } else {
+                    filter_answers(args, *dictionary, restriction, surviving_answer_indexes, possible_answers);
+                    filter_guesses(
+                        args,
+                        *dictionary,
+                        restriction,
+                        surviving_guess_indexes,
+                        dictionary->guesses,
+                        possible_guesses
+                    );
+                }
+            }
+        }
+
         switch (user_action) {
             case 1: {// enter new
+                refining_search.reset();
                 WordArray word = get_word_from_user();
-                ResponseArray response = get_response_from_user();
-                restriction.update_from_word_guess(word, response);
-                possible_answers = restriction.get_surviving_words(possible_answers);
-
-                // Along the lines of std::remove_if, except that requires nonsense
-                // and almost as much code
-                std::vector<WordArray> new_possible_guesses;
-                new_possible_guesses.reserve(possible_guesses.size());
-                for (auto& guess : possible_guesses) {
-                    if (restriction.can_provide_new_information(guess))
-                        new_possible_guesses.push_back(std::move(guess));
+                if (args.is_hard_mode && !restriction.is_word_allowed(word)) {
+                    std::cout << word_vec_to_string(word)
+                        << " doesn't fit the hints so far, so can't be played in hard mode."
+                        << std::endl;
+                    break;
+                }
+
+                // Starts working in the background right away, so has to be
+                // made before asking for the response
+                std::unique_ptr<SpeculativeTurn> speculation;
+                if (args.do_speculate) {
+                    speculation = std::make_unique<SpeculativeTurn>(
+                        word,
+                        possible_guesses,
+                        possible_answers,
+                        restriction,
+                        args.do_exhaustive ? 0 : get_num_ranked_wanted(args),
+                        args.is_hard_mode
+                    );
+                }
+
+                ResponseCode response_code = get_response_from_user();
+                if (is_all_green(response_code)) {
+                    std::cout << "Solved it!" << std::endl;
+                }
+                is_first_turn = false;
+                std::optional<TurnResult> turn_result;
+                if (speculation) {
+                    turn_result = speculation->claim(response_code_to_array(response_code));
+                    speculation.reset();
+                }
+                cached_suggestions.reset();
+
+                if (turn_result.has_value()) {
+                    restriction = turn_result->restriction;
+                    possible_answers = std::move(turn_result->possible_answers);
+                    possible_guesses = std::move(turn_result->possible_guesses);
+                    cached_suggestions = std::move(turn_result->ranked_guesses);
+                    std::cout << "(Next turn was precomputed)" << std::endl;
+                    restriction.print();
+                    break;
                 }
-                possible_guesses = std::move(new_possible_guesses);
+
+                restriction.update_from_word_guess(word, response_code);
+                std::cout << "Initial Words Len: " << possible_answers.size() << std::endl;
+                filter_answers(args, *dictionary, restriction, surviving_answer_indexes, possible_answers);
+                if (args.use_trie) {
+                    std::cout << "Guesses that fit the hints: "
+                        << dictionary->guess_trie.count_matching_words(restriction) << std::endl;
+                }
+                filter_guesses(
+                    args,
+                    *dictionary,
+                    restriction,
+                    surviving_guess_indexes,
+                    std::move(possible_guesses),
+                    possible_guesses
+                );
 
                 restriction.print();
                 break;
@@ -370,19 +1142,69 @@ int main(int argc, char** argv) {
                 std::cout << std::endl;
                 break;
             case 3: // get suggestion
-                print_suggestions(
+                if (!cached_suggestions.has_value() && args.do_refine) {
+                    if (!refining_search) {
+                        refining_search = std::make_unique<AnytimeSearch>(
+                            possible_guesses,
+                            possible_answers,
+                            restriction,
+                            get_num_ranked_wanted(args)
+                        );
+                    }
+                    std::vector<RankedGuess> ranked_guesses = get_anytime_suggestions(
+                        args,
+                        *refining_search,
+                        true
+                    );
+                    if (refining_search->is_complete()) {
+                        cached_suggestions = std::move(ranked_guesses);
+                        refining_search.reset();
+                    } else {
+                        print_ranked_guesses(ranked_guesses);
+                        print_lookahead(
+                            args.num_lookahead_candidates,
+                            ranked_guesses,
+                            possible_guesses,
+                            possible_answers,
+                            args.is_hard_mode
+                        );
+                        break;
+                    }
+                }
+                if (!cached_suggestions.has_value()) {
+                    cached_suggestions = get_suggestions(
+                        args,
+                        possible_guesses,
+                        possible_answers,
+                        restriction
+                    );
+                }
+                print_ranked_guesses(*cached_suggestions);
+                print_lookahead(
+                    args.num_lookahead_candidates,
+                    *cached_suggestions,
                     possible_guesses,
                     possible_answers,
-                    restriction
+                    args.is_hard_mode
                 );
                 break;
-            case 4:
-                print_suggestions(
+            case 4: {
+                std::vector<RankedGuess> ranked_guesses = get_suggestions(
+                    args,
                     possible_answers,
                     possible_answers,
                     restriction
                 );
+                print_ranked_guesses(ranked_guesses);
+                print_lookahead(
+                    args.num_lookahead_candidates,
+                    ranked_guesses,
+                    possible_answers,
+                    possible_answers,
+                    args.is_hard_mode
+                );
                 break;
+            }
             case 5:
                 return 0;
                 break;
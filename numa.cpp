@@ -0,0 +1,320 @@
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cctype>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <omp.h>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <sched.h>
+#include <filesystem>
+#endif
+
+#include "numa.hpp"
+#include "profiler.hpp"
+
+static bool numa_mode = false;
+
+// With --profile, every this many-th tile is scored before the rest with no
+// pinning and everything reading node 0's copy - the way it'd go without
+// --numa - so the report has something to compare the pinned rates against.
+// Spread out rather than the first few, so it has the same mix of guesses.
+static constexpr int64_t CALIBRATION_STRIDE = 16;
+
+#if defined(_WIN32)
+// CPU numbers here are group * 64 + bit, since Windows splits CPUs into groups of 64
+typedef GROUP_AFFINITY SavedAffinity;
+
+static std::vector<NumaNode> detect_numa_nodes() {
+    std::vector<NumaNode> nodes;
+    ULONG highest_node = 0;
+    if (!GetNumaHighestNodeNumber(&highest_node)) {
+        return nodes;
+    }
+    for (ULONG node_id = 0; node_id <= highest_node; node_id++) {
+        GROUP_AFFINITY affinity = {};
+        if (!GetNumaNodeProcessorMaskEx((USHORT) node_id, &affinity)) {
+            continue;
+        }
+        NumaNode node;
+        node.node_id = node_id;
+        for (uint32_t bit = 0; bit < 64; bit++) {
+            if (affinity.Mask & ((KAFFINITY) 1 << bit)) {
+                node.cpus.push_back(affinity.Group * 64 + bit);
+            }
+        }
+        if (!node.cpus.empty()) {
+            nodes.push_back(std::move(node));
+        }
+    }
+    return nodes;
+}
+
+static bool pin_current_thread_to(const std::vector<uint32_t>& cpus) {
+    GROUP_AFFINITY affinity = {};
+    affinity.Group = cpus.front() / 64;
+    for (auto cpu : cpus) {
+        if (cpu / 64 == affinity.Group) {
+            affinity.Mask |= (KAFFINITY) 1 << (cpu % 64);
+        }
+    }
+    return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr);
+}
+
+static bool save_affinity(SavedAffinity& saved) {
+    return GetThreadGroupAffinity(GetCurrentThread(), &saved);
+}
+
+static void restore_affinity(const SavedAffinity& saved) {
+    SetThreadGroupAffinity(GetCurrentThread(), &saved, nullptr);
+}
+
+#elif defined(__linux__)
+typedef cpu_set_t SavedAffinity;
+
+// "0-3,8-11" -> 0 1 2 3 8 9 10 11
+static std::vector<uint32_t> parse_cpu_list(const std::string& cpu_list) {
+    std::vector<uint32_t> cpus;
+    std::stringstream ranges(cpu_list);
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+        if (range.empty() || range == "\n") continue;
+        std::size_t dash_pos = range.find('-');
+        uint32_t first = std::stoul(range.substr(0, dash_pos));
+        uint32_t last = dash_pos == std::string::npos ? first : std::stoul(range.substr(dash_pos + 1));
+        for (uint32_t cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+static std::vector<NumaNode> detect_numa_nodes() {
+    std::vector<NumaNode> nodes;
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed)) {
+        return nodes;
+    }
+
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", error)) {
+        std::string name = entry.path().filename().string();
+        if (name.rfind("node", 0) != 0 || name.size() == 4 || !std::isdigit(name[4])) {
+            continue;
+        }
+        std::ifstream fin(entry.path() / "cpulist");
+        std::string cpu_list;
+        if (!std::getline(fin, cpu_list)) {
+            continue;
+        }
+        NumaNode node;
+        node.node_id = std::stoul(name.substr(4));
+        try {
+            for (auto cpu : parse_cpu_list(cpu_list)) {
+                if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) {
+                    node.cpus.push_back(cpu);
+                }
+            }
+        } catch (const std::exception&) {
+            continue;
+        }
+        if (!node.cpus.empty()) {
+            nodes.push_back(std::move(node));
+        }
+    }
+    std::sort(
+        nodes.begin(),
+        nodes.end(),
+        [](const NumaNode& node1, const NumaNode& node2) {return node1.node_id < node2.node_id; }
+    );
+    return nodes;
+}
+
+static bool pin_current_thread_to(const std::vector<uint32_t>& cpus) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (auto cpu : cpus) {
+        CPU_SET(cpu, &cpu_set);
+    }
+    return sched_setaffinity(0, sizeof(cpu_set), &cpu_set) == 0;
+}
+
+static bool save_affinity(SavedAffinity& saved) {
+    return sched_getaffinity(0, sizeof(saved), &saved) == 0;
+}
+
+static void restore_affinity(const SavedAffinity& saved) {
+    sched_setaffinity(0, sizeof(saved), &saved);
+}
+
+#else
+typedef int SavedAffinity;
+
+static std::vector<NumaNode> detect_numa_nodes() {
+    return {};
+}
+
+static bool pin_current_thread_to(const std::vector<uint32_t>&) {
+    return false;
+}
+
+static bool save_affinity(SavedAffinity&) {
+    return false;
+}
+
+static void restore_affinity(const SavedAffinity&) {}
+#endif
+
+const std::vector<NumaNode>& get_numa_nodes() {
+    static const std::vector<NumaNode> nodes = []() {
+        std::vector<NumaNode> detected = detect_numa_nodes();
+        if (detected.empty()) {
+            // Don't know, so call it one node with every CPU omp would use
+            NumaNode node;
+            for (uint32_t cpu = 0; cpu < (uint32_t) omp_get_num_procs(); cpu++) {
+                node.cpus.push_back(cpu);
+            }
+            detected.push_back(std::move(node));
+        }
+        return detected;
+    }();
+    return nodes;
+}
+
+void set_numa_mode(bool is_enabled) {
+    numa_mode = is_enabled;
+}
+
+bool is_numa_mode() {
+    return numa_mode;
+}
+
+bool is_numa_active() {
+    return numa_mode && get_numa_nodes().size() > 1;
+}
+
+bool pin_current_thread(uint32_t cpu) {
+    return pin_current_thread_to({cpu});
+}
+
+void run_on_each_node(const std::function<void(std::size_t node_index)>& func) {
+    const auto& nodes = get_numa_nodes();
+    for (std::size_t node_index = 0; node_index < nodes.size(); node_index++) {
+        std::thread worker([&]() {
+            pin_current_thread_to(nodes[node_index].cpus);
+            func(node_index);
+        });
+        worker.join();
+    }
+}
+
+// body, with the response kernel pairs and time it took added to the calling
+// thread's pinned or unpinned totals if profiling
+static void run_timed_tile(
+    const std::function<void(int64_t tile_index, std::size_t node_index)>& body,
+    int64_t tile_index,
+    std::size_t node_index,
+    bool is_pinned
+) {
+    if (!g_profiling_enabled) {
+        body(tile_index, node_index);
+        return;
+    }
+    ThreadProfile& profile = get_thread_profile();
+    const uint64_t pairs_before = profile.response_pairs;
+    const uint64_t cycles_before = profile.cycles[PROFILE_RESPONSE];
+    body(tile_index, node_index);
+    (is_pinned ? profile.pinned_cycles : profile.unpinned_cycles) += (
+        profile.cycles[PROFILE_RESPONSE] - cycles_before
+    );
+    (is_pinned ? profile.pinned_pairs : profile.unpinned_pairs) += profile.response_pairs - pairs_before;
+}
+
+void for_each_tile_by_node(
+    int64_t num_tiles,
+    const std::function<void(int64_t tile_index, std::size_t node_index)>& body
+) {
+    if (!is_numa_active()) {
+        // tile_index is signed to make omp happy
+        #pragma omp parallel for schedule(dynamic)
+        for (int64_t tile_index = 0; tile_index < num_tiles; tile_index++) {
+            body(tile_index, 0);
+        }
+        return;
+    }
+
+    const auto& nodes = get_numa_nodes();
+    std::vector<uint32_t> thread_to_cpu;
+    std::vector<std::size_t> thread_to_node;
+    for (std::size_t node_index = 0; node_index < nodes.size(); node_index++) {
+        for (auto cpu : nodes[node_index].cpus) {
+            thread_to_cpu.push_back(cpu);
+            thread_to_node.push_back(node_index);
+        }
+    }
+
+    // Node i's share is tiles i, i + num_nodes, i + 2 * num_nodes, ..., so every
+    // node gets some of the early tiles (which get_top_ranked_guesses fills with
+    // its most promising guesses). node_to_next[i] counts through node i's share.
+    const std::size_t num_nodes = nodes.size();
+    std::unique_ptr<std::atomic<int64_t>[]> node_to_next(new std::atomic<int64_t>[num_nodes]);
+    for (std::size_t node_index = 0; node_index < num_nodes; node_index++) {
+        node_to_next[node_index] = 0;
+    }
+
+    // Threads made later by the calling thread would inherit its pinning
+    SavedAffinity saved_affinity;
+    bool is_affinity_saved = save_affinity(saved_affinity);
+
+    // Baseline tiles first: the same threads, but each allowed on every CPU
+    // (they'd otherwise still be pinned from the last loop)
+    const bool is_calibrating = g_profiling_enabled;
+    if (is_calibrating) {
+        #pragma omp parallel num_threads((int) thread_to_cpu.size())
+        {
+            pin_current_thread_to(thread_to_cpu);
+            #pragma omp for schedule(dynamic)
+            for (int64_t tile_index = 0; tile_index < num_tiles; tile_index += CALIBRATION_STRIDE) {
+                run_timed_tile(body, tile_index, 0, false);
+            }
+        }
+    }
+
+    #pragma omp parallel num_threads((int) thread_to_cpu.size())
+    {
+        const int thread_num = omp_get_thread_num();
+        const std::size_t node_index = thread_to_node[thread_num];
+        pin_current_thread(thread_to_cpu[thread_num]);
+        if (g_profiling_enabled) {
+            get_thread_profile().numa_node = nodes[node_index].node_id;
+        }
+
+        // Own node's share first, then help with the others'
+        for (std::size_t offset = 0; offset < num_nodes; offset++) {
+            std::size_t share_index = (node_index + offset) % num_nodes;
+            while (true) {
+                int64_t tile_index = share_index + num_nodes * node_to_next[share_index]++;
+                if (tile_index >= num_tiles) {
+                    break;
+                }
+                if (is_calibrating && tile_index % CALIBRATION_STRIDE == 0) {
+                    continue;  // already done
+                }
+                run_timed_tile(body, tile_index, node_index, true);
+            }
+        }
+    }
+
+    if (is_affinity_saved) {
+        restore_affinity(saved_affinity);
+    }
+}
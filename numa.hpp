@@ -0,0 +1,102 @@
+#ifndef numa_hpp
+#define numa_hpp
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <stdint.h>
+
+// Support for spreading scoring over the sockets of a multi socket machine
+// (--numa). Read only data that every thread streams through (the answer list)
+// is copied once per NUMA node, each copy made by a thread pinned to that node
+// so that the OS puts it in that node's memory (first touch). Scoring threads
+// are pinned to CPUs and read their own node's copy, so nothing crosses the
+// interconnect in the inner loop. Uses only what the OS provides (sysfs and
+// sched_setaffinity on Linux, the Win32 NUMA calls on Windows), not libnuma.
+
+struct NumaNode {
+    uint32_t node_id = 0;
+    std::vector<uint32_t> cpus;  // only the ones this process is allowed on
+};
+
+// Every node with at least one usable CPU. Always at least one node - if the OS
+// can't say, everything is node 0. Worked out once, on first use.
+const std::vector<NumaNode>& get_numa_nodes();
+
+// Off by default. Turning it on doesn't do anything until something is scored.
+void set_numa_mode(bool is_enabled);
+bool is_numa_mode();
+
+// True if the mode is on and there's more than one node to use
+bool is_numa_active();
+
+// Pins the calling thread to one CPU. Returns false (and leaves the thread
+// alone) if the OS says no.
+bool pin_current_thread(uint32_t cpu);
+
+// Calls func(node_index) once per node, each from a thread pinned to that node,
+// one node at a time. Whatever func allocates and fills is then local to the node.
+void run_on_each_node(const std::function<void(std::size_t node_index)>& func);
+
+// Calls body(tile_index, node_index) for every tile in [0, num_tiles), in
+// parallel. node_index is the node the calling thread is on, for picking which
+// NodeReplicas copy to read.
+//
+// With NUMA active, the tiles are dealt out to the nodes round robin, one
+// OpenMP thread is pinned to each CPU, and each thread works through its own
+// node's tiles before helping with the others'. Otherwise this is a plain
+// dynamic omp loop, with node_index always 0.
+void for_each_tile_by_node(
+    int64_t num_tiles,
+    const std::function<void(int64_t tile_index, std::size_t node_index)>& body
+);
+
+// One copy of original per node while NUMA is active, otherwise just original
+// itself (which then has to outlive this). Use get_node_replicas rather than
+// making these directly, so the same list isn't copied over and over.
+template <typename T>
+class NodeReplicas {
+public:
+    explicit NodeReplicas(const T& original) : original(&original) {
+        if (!is_numa_active()) {
+            return;
+        }
+        copies.resize(get_numa_nodes().size());
+        run_on_each_node([&](std::size_t node_index) {
+            copies[node_index] = std::make_unique<T>(original);
+        });
+        this->original = nullptr;  // only the copies are needed from here on
+    }
+
+    const T& get(std::size_t node_index) const {
+        return copies.empty() ? *original : *copies[node_index];
+    }
+
+private:
+    const T* original;
+    std::vector<std::unique_ptr<T>> copies;
+};
+
+// NodeReplicas of original. While NUMA is active, the last ones made for each
+// type are kept, and handed out again if original has the same contents - so
+// the answer list is copied to the nodes once per turn, not once per scoring
+// call (suggestions, --refine rounds, lookahead and speculation all rescore it).
+template <typename T>
+std::shared_ptr<const NodeReplicas<T>> get_node_replicas(const T& original) {
+    if (!is_numa_active()) {
+        return std::make_shared<const NodeReplicas<T>>(original);
+    }
+    static std::mutex cache_mutex;
+    static T cached_original;
+    static std::shared_ptr<const NodeReplicas<T>> cached_replicas;
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    if (cached_replicas == nullptr || cached_original != original) {
+        cached_original = original;
+        cached_replicas = std::make_shared<const NodeReplicas<T>>(original);
+    }
+    return cached_replicas;
+}
+
+#endif
@@ -0,0 +1,433 @@
+#include <vector>
+#include <array>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <numeric>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <stdint.h>
+#include <omp.h>
+
+#include "opening_pair.hpp"
+#include "get_suggestion.hpp"
+#include "response_code.hpp"
+#include "profiler.hpp"
+#include "common.hpp"
+
+// Response codes are kept a byte each: guesses x answers of them is the big table
+typedef uint8_t CompactCode;
+static_assert(NUM_RESPONSES <= 256, "Response codes have to fit in a byte");
+
+// One guess's buckets on its own
+struct GuessPartition {
+    std::vector<uint32_t> bucket_sizes;  // nonempty ones, biggest first
+    uint64_t sum_of_squares = 0;
+};
+
+// Median and mean as one integer, median in the high half. Both are non
+// negative floats, whose bits sort the same way they do, so the smaller packed
+// value is the better score.
+static constexpr uint64_t NO_SCORE = UINT64_MAX;
+
+static uint64_t pack_score(const GuessStats& stats) {
+    uint32_t median_bits, mean_bits;
+    std::memcpy(&median_bits, &stats.median, sizeof(median_bits));
+    std::memcpy(&mean_bits, &stats.mean, sizeof(mean_bits));
+    return ((uint64_t) median_bits << 32) | mean_bits;
+}
+
+static GuessStats unpack_score(uint64_t packed) {
+    GuessStats stats;
+    uint32_t median_bits = packed >> 32;
+    uint32_t mean_bits = packed & 0xffffffff;
+    std::memcpy(&stats.median, &median_bits, sizeof(median_bits));
+    std::memcpy(&stats.mean, &mean_bits, sizeof(mean_bits));
+    return stats;
+}
+
+// Smallest possible sum of squares of size answers split into at most
+// max_pieces buckets (as evenly as possible)
+static uint64_t get_min_sum_of_squares(uint64_t size, uint64_t max_pieces) {
+    if (size <= max_pieces) {
+        return size;
+    }
+    uint64_t quotient = size / max_pieces;
+    uint64_t remainder = size % max_pieces;
+    return remainder * (quotient + 1) * (quotient + 1) + (max_pieces - remainder) * quotient * quotient;
+}
+
+// How much more than 1 per answer splitting each of bucket_sizes into at most
+// max_pieces has to cost. Only buckets bigger than max_pieces add anything,
+// and they're first.
+static uint64_t get_min_extra_sum_of_squares(
+    const std::vector<uint32_t>& bucket_sizes,
+    uint64_t max_pieces
+) {
+    uint64_t extra = 0;
+    for (auto bucket_size : bucket_sizes) {
+        if (bucket_size <= max_pieces) {
+            break;
+        }
+        extra += get_min_sum_of_squares(bucket_size, max_pieces) - bucket_size;
+    }
+    return extra;
+}
+
+static bool pair_comparitor(const RankedPair& pair1, const RankedPair& pair2) {
+    if (is_better_score(pair1.stats, pair2.stats)) {
+        return true;
+    }
+    if (is_better_score(pair2.stats, pair1.stats)) {
+        return false;
+    }
+    return (
+        word_vec_to_string(pair1.first_guess) + word_vec_to_string(pair1.second_guess)
+        < word_vec_to_string(pair2.first_guess) + word_vec_to_string(pair2.second_guess)
+    );
+}
+
+// Everything one thread needs to score pairs, reused from pair to pair
+struct PairScorer {
+    PairScorer(
+        const std::vector<CompactCode>& codes,
+        const std::vector<GuessPartition>& partitions,
+        std::size_t num_answers,
+        std::size_t num_wanted,
+        bool is_exhaustive,
+        std::atomic<uint64_t>& shared_threshold
+    ) :
+        codes(codes),
+        partitions(partitions),
+        num_answers(num_answers),
+        num_wanted(num_wanted),
+        is_exhaustive(is_exhaustive),
+        shared_threshold(shared_threshold),
+        answer_order(num_answers)
+    {
+        // Sized once here, so scoring pairs never allocates
+        bucket_ends.reserve(NUM_RESPONSES);
+        joint_bucket_sizes.reserve(num_answers);  // at most one bucket per answer
+        best.reserve(num_wanted + 1);
+    }
+
+    const std::vector<CompactCode>& codes;
+    const std::vector<GuessPartition>& partitions;
+    const std::size_t num_answers;
+    const std::size_t num_wanted;
+    const bool is_exhaustive;
+    std::atomic<uint64_t>& shared_threshold;
+
+    // The first guess's answers, grouped by its response, biggest group first
+    std::vector<uint32_t> answer_order;
+    std::vector<std::size_t> bucket_ends;
+
+    std::array<uint32_t, NUM_RESPONSES> response_counts = {};
+    std::array<CompactCode, NUM_RESPONSES + 1> seen_responses = {};  // +1 for the branchless append
+    std::vector<uint32_t> joint_bucket_sizes;
+
+    std::vector<RankedPair> best;  // this thread's top num_wanted, best first
+    uint64_t num_pairs = 0;
+    uint64_t num_pruned = 0;
+    uint64_t num_responses = 0;
+
+    void set_first_guess(std::size_t first_index) {
+        const CompactCode* first_codes = codes.data() + first_index * num_answers;
+        std::array<uint32_t, NUM_RESPONSES> histogram = {};
+        for (std::size_t answer_index = 0; answer_index < num_answers; answer_index++) {
+            histogram[first_codes[answer_index]]++;
+        }
+        std::vector<CompactCode> bucket_codes;
+        for (uint32_t code = 0; code < NUM_RESPONSES; code++) {
+            if (histogram[code]) {
+                bucket_codes.push_back(code);
+            }
+        }
+        std::stable_sort(
+            bucket_codes.begin(),
+            bucket_codes.end(),
+            [&](CompactCode code1, CompactCode code2) {return histogram[code1] > histogram[code2]; }
+        );
+
+        std::array<std::size_t, NUM_RESPONSES> code_to_offset;
+        bucket_ends.clear();
+        std::size_t offset = 0;
+        for (auto code : bucket_codes) {
+            code_to_offset[code] = offset;
+            offset += histogram[code];
+            bucket_ends.push_back(offset);
+        }
+        for (std::size_t answer_index = 0; answer_index < num_answers; answer_index++) {
+            answer_order[code_to_offset[first_codes[answer_index]]++] = answer_index;
+        }
+    }
+
+    // Adds first_index + second_index to best, unless it's certainly not good
+    // enough for the top num_wanted. set_first_guess(first_index) has to come first.
+    void score_pair(
+        const std::vector<WordArray>& possible_guesses,
+        std::size_t first_index,
+        std::size_t second_index
+    ) {
+        num_pairs++;
+        const GuessPartition& first_partition = partitions[first_index];
+        const GuessPartition& second_partition = partitions[second_index];
+
+        // Can only get tighter while this pair is being scored, so an old copy is fine
+        const uint64_t packed_threshold = shared_threshold.load(std::memory_order_relaxed);
+        const bool is_pruning = !is_exhaustive && packed_threshold != NO_SCORE;
+        const GuessStats threshold = unpack_score(packed_threshold);
+        auto is_certainly_worse = [&](float min_median, uint64_t min_sum_of_squares) {
+            GuessStats bound;
+            bound.median = min_median;
+            bound.mean = (float) min_sum_of_squares / num_answers;
+            return is_better_score(threshold, bound);
+        };
+
+        // Before looking at a single answer: neither guess's buckets can be
+        // split into more pieces than the other guess has buckets
+        uint64_t first_extra = get_min_extra_sum_of_squares(
+            first_partition.bucket_sizes,
+            second_partition.bucket_sizes.size()
+        );
+        if (is_pruning) {
+            uint64_t second_extra = get_min_extra_sum_of_squares(
+                second_partition.bucket_sizes,
+                first_partition.bucket_sizes.size()
+            );
+            if (is_certainly_worse(1, num_answers + std::max(first_extra, second_extra))) {
+                num_pruned++;
+                return;
+            }
+        }
+
+        // Joint buckets smaller than these are counted, to bound the median
+        const uint64_t median_index = (num_answers - 1) / 2;
+        const uint32_t median_floor = is_pruning ? (uint32_t) std::floor(threshold.median) : 0;
+        uint64_t num_below_floor = 0;
+        uint64_t num_below_floor_plus_one = 0;
+
+        const CompactCode* second_codes = codes.data() + second_index * num_answers;
+        const std::size_t max_second_pieces = second_partition.bucket_sizes.size();
+        uint64_t sum_of_squares = 0;
+        std::size_t num_seen = 0;
+        joint_bucket_sizes.clear();
+        for (std::size_t bucket_index = 0; bucket_index < bucket_ends.size(); bucket_index++) {
+            const std::size_t bucket_begin = num_seen;
+            const std::size_t bucket_end = bucket_ends[bucket_index];
+
+            std::size_t num_seen_responses = 0;
+            for (std::size_t order_index = bucket_begin; order_index < bucket_end; order_index++) {
+                CompactCode code = second_codes[answer_order[order_index]];
+                seen_responses[num_seen_responses] = code;
+                num_seen_responses += response_counts[code] == 0;
+                response_counts[code]++;
+            }
+            for (std::size_t seen_index = 0; seen_index < num_seen_responses; seen_index++) {
+                uint32_t& joint_bucket_size = response_counts[seen_responses[seen_index]];
+                sum_of_squares += (uint64_t) joint_bucket_size * joint_bucket_size;
+                num_below_floor += joint_bucket_size < median_floor ? joint_bucket_size : 0;
+                num_below_floor_plus_one += joint_bucket_size < median_floor + 1 ? joint_bucket_size : 0;
+                joint_bucket_sizes.push_back(joint_bucket_size);
+                joint_bucket_size = 0;
+            }
+            num_seen = bucket_end;
+            first_extra -= (
+                get_min_sum_of_squares(bucket_end - bucket_begin, max_second_pieces)
+                - (bucket_end - bucket_begin)
+            );
+
+            if (!is_pruning || num_seen == num_answers) {
+                continue;
+            }
+            // Every joint bucket so far is final. The answers still to come
+            // could all be in buckets of 1 as far as the median knows.
+            const uint64_t num_left = num_answers - num_seen;
+            float min_median = 1;
+            if (num_below_floor_plus_one + num_left <= median_index) {
+                min_median = median_floor + 1;
+            } else if (median_floor > 1 && num_below_floor + num_left <= median_index) {
+                min_median = median_floor;
+            }
+            if (is_certainly_worse(min_median, sum_of_squares + num_left + first_extra)) {
+                num_responses += num_seen;
+                num_pruned++;
+                return;
+            }
+        }
+        num_responses += num_answers;
+
+        RankedPair ranked_pair;
+        ranked_pair.first_guess = possible_guesses[first_index];
+        ranked_pair.second_guess = possible_guesses[second_index];
+        ranked_pair.stats = get_stats_from_bucket_sizes(
+            joint_bucket_sizes.data(),
+            joint_bucket_sizes.size(),
+            num_answers
+        );
+        _add_to_best(ranked_pair);
+    }
+
+    void _add_to_best(const RankedPair& ranked_pair) {
+        if (best.size() == num_wanted && !pair_comparitor(ranked_pair, best.back())) {
+            return;
+        }
+        best.insert(std::upper_bound(best.begin(), best.end(), ranked_pair, pair_comparitor), ranked_pair);
+        if (best.size() > num_wanted) {
+            best.pop_back();
+        }
+        if (best.size() == num_wanted) {
+            // This thread's num_wanted-th best is no better than everyone's
+            uint64_t packed = pack_score(best.back().stats);
+            uint64_t current = shared_threshold.load();
+            while (packed < current && !shared_threshold.compare_exchange_weak(current, packed)) {}
+        }
+    }
+};
+
+std::vector<RankedPair> get_top_opening_pairs(
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers,
+    std::size_t num_wanted,
+    bool is_exhaustive,
+    const std::atomic_bool* cancel_flag,
+    bool show_progress,
+    PairPruningStats* pruning_stats
+) {
+    if (has_answer_weights()) {
+        throw std::runtime_error("Opening pairs can't be found for weighted answer lists yet");
+    }
+    const std::size_t num_guesses = possible_guesses.size();
+    const std::size_t num_answers = possible_answers.size();
+    if (num_wanted == 0 || num_guesses < 2 || num_answers == 0) {
+        return {};
+    }
+
+    // Every guess's response for every answer, and its buckets on its own
+    std::vector<CompactCode> codes(num_guesses * num_answers);
+    std::vector<GuessPartition> partitions(num_guesses);
+    {
+        ProfileTimer timer(PROFILE_RESPONSE);
+        // guess_index is signed to make omp happy
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (int64_t guess_index = 0; guess_index < (int64_t) num_guesses; guess_index++) {
+            CompactCode* guess_codes = codes.data() + guess_index * num_answers;
+            ResponseHistogram histogram = {};
+            for (std::size_t answer_index = 0; answer_index < num_answers; answer_index++) {
+                guess_codes[answer_index] = calculate_response_code(
+                    possible_guesses[guess_index],
+                    possible_answers[answer_index]
+                );
+                histogram[guess_codes[answer_index]]++;
+            }
+            GuessPartition& partition = partitions[guess_index];
+            for (auto bucket_size : histogram) {
+                if (bucket_size) {
+                    partition.bucket_sizes.push_back(bucket_size);
+                    partition.sum_of_squares += (uint64_t) bucket_size * bucket_size;
+                }
+            }
+            std::sort(partition.bucket_sizes.begin(), partition.bucket_sizes.end(), std::greater<uint32_t>());
+        }
+    }
+
+    // Best guesses on their own first: good pairs tend to be made of them, so
+    // the threshold gets tight early. Each pair is only scored once, with the
+    // better guess first.
+    std::vector<std::size_t> guess_order(num_guesses);
+    std::iota(guess_order.begin(), guess_order.end(), 0);
+    std::stable_sort(
+        guess_order.begin(),
+        guess_order.end(),
+        [&](std::size_t guess_index1, std::size_t guess_index2) {
+            return partitions[guess_index1].sum_of_squares < partitions[guess_index2].sum_of_squares;
+        }
+    );
+
+    std::atomic<uint64_t> shared_threshold = NO_SCORE;
+    std::vector<RankedPair> all_best;
+    PairPruningStats totals;
+
+    std::atomic_uint32_t num_done = 0;
+    std::atomic_uint32_t print_lockish = 0;
+    if (show_progress) {
+        std::cout << "\nChecked 0 of " << num_guesses << " first guesses    " << std::flush;
+    }
+
+    #pragma omp parallel
+    {
+        PairScorer scorer(codes, partitions, num_answers, num_wanted, is_exhaustive, shared_threshold);
+
+        // Later first guesses have fewer second guesses left, so hand them out one at a time
+        #pragma omp for schedule(dynamic, 1)
+        for (int64_t first_rank = 0; first_rank < (int64_t) num_guesses; first_rank++) {
+            if (cancel_flag != nullptr && *cancel_flag) {
+                continue;
+            }
+            ProfileTimer timer(PROFILE_SCORE);
+            const std::size_t first_index = guess_order[first_rank];
+            scorer.set_first_guess(first_index);
+            for (std::size_t second_rank = first_rank + 1; second_rank < num_guesses; second_rank++) {
+                scorer.score_pair(possible_guesses, first_index, guess_order[second_rank]);
+            }
+
+            num_done++;
+            if (
+                show_progress
+                && !(print_lockish++)
+            ) {
+                std::cout << "\rChecked " << num_done << " of " << num_guesses
+                    << " first guesses    " << std::flush;
+                print_lockish = 0;
+            }
+        }
+
+        #pragma omp critical
+        {
+            all_best.insert(all_best.end(), scorer.best.begin(), scorer.best.end());
+            totals.num_pairs += scorer.num_pairs;
+            totals.num_pruned += scorer.num_pruned;
+            totals.num_responses += scorer.num_responses;
+        }
+    }
+
+    if (cancel_flag != nullptr && *cancel_flag) {
+        return {};
+    }
+
+    if (pruning_stats != nullptr) {
+        *pruning_stats = totals;
+    }
+    if (show_progress) {
+        std::cout << "\rChecked " << num_done << " of " << num_guesses
+            << " first guesses    " << std::endl;
+        std::cout << "Pruned " << totals.num_pruned << " of " << totals.num_pairs
+            << " pairs early, scored " << std::fixed << std::setprecision(1)
+            << 100.0 * totals.num_responses / ((double) totals.num_pairs * num_answers)
+            << "% of pair/answer combinations" << std::endl;
+    }
+
+    std::sort(all_best.begin(), all_best.end(), pair_comparitor);
+    all_best.resize(std::min(num_wanted, all_best.size()));
+    return all_best;
+}
+
+void print_ranked_pairs(const std::vector<RankedPair>& ranked_pairs) {
+    ProfileTimer timer(PROFILE_IO);
+    std::cout
+        << "BEST OPENING PAIRS (sorted by decreasing ~remaining answers after both):\n"
+        << "  " << std::setw(2 * WORD_LENGTH + 1) << "Words" << " | Median  | Mean    | StdDev  |\n"
+        << "  " << std::string(2 * WORD_LENGTH + 32, '-') << "\n";
+    for (const auto& ranked_pair : ranked_pairs) {
+        std::cout << "  " << word_vec_to_string(ranked_pair.first_guess)
+            << " " << word_vec_to_string(ranked_pair.second_guess) << " | "
+            << std::fixed << std::setprecision(2)
+            << std::setw(7) << ranked_pair.stats.median << " | "
+            << std::setw(7) << ranked_pair.stats.mean   << " | "
+            << std::setw(7) << ranked_pair.stats.stddev << " |"
+            << std::endl;
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef opening_pair_hpp
+#define opening_pair_hpp
+
+#include <vector>
+#include <atomic>
+#include <stdint.h>
+
+#include "get_suggestion.hpp"
+#include "common.hpp"
+
+// A fixed two word opening: the same two guesses whatever the first response
+struct RankedPair {
+    WordArray first_guess;   // the better of the two on its own
+    WordArray second_guess;
+    GuessStats stats;        // of the answers left after both
+};
+
+struct PairPruningStats {
+    uint64_t num_pairs = 0;
+    uint64_t num_pruned = 0;      // dropped before every answer was scored
+    uint64_t num_responses = 0;   // pair/answer combinations actually scored
+};
+
+// The best num_wanted pairs of possible_guesses as an opening (--opening-pair),
+// best first, ranked like rank_guesses ranks single guesses. A pair's buckets
+// are the answers that get the same response to both guesses, so each answer
+// only needs its two response codes - which are worked out once per guess, not
+// once per pair.
+//
+// Unless is_exhaustive, pairs are dropped part way through once they're
+// certainly out of the top num_wanted. Answers are gone through a bucket of the
+// first guess at a time (biggest first), so every joint bucket made so far is
+// final; and a first guess bucket can't be split into more pieces than the
+// second guess has responses, which bounds what the rest can add. Each thread
+// keeps its own top num_wanted, and only the threshold they prune against is
+// shared. Unweighted only.
+std::vector<RankedPair> get_top_opening_pairs(
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers,
+    std::size_t num_wanted,
+    bool is_exhaustive = false,
+    const std::atomic_bool* cancel_flag = nullptr,
+    bool show_progress = true,
+    PairPruningStats* pruning_stats = nullptr
+);
+
+void print_ranked_pairs(const std::vector<RankedPair>& ranked_pairs);
+
+#endif
@@ -0,0 +1,209 @@
+#include <vector>
+#include <string>
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+#include "partial_results.hpp"
+#include "profiler.hpp"
+#include "common.hpp"
+
+static constexpr char PARTIAL_RESULTS_MAGIC[8] = {'W', 'S', 'S', 'H', 'A', 'R', 'D', '1'};
+
+static constexpr uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325;
+static constexpr uint64_t FNV_PRIME = 0x100000001b3;
+
+static void hash_byte(uint64_t& hash, uint8_t byte) {
+    hash ^= byte;
+    hash *= FNV_PRIME;
+}
+
+static void hash_word_list(uint64_t& hash, const std::vector<WordArray>& words) {
+    for (const auto& word : words) {
+        for (auto letter : word) {
+            hash_byte(hash, letter);
+        }
+    }
+    // So that moving a word from the end of one list to the start of the next changes the hash
+    for (int shift = 0; shift < 64; shift += 8) {
+        hash_byte(hash, (words.size() >> shift) & 0xff);
+    }
+}
+
+uint64_t hash_word_lists(
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers
+) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    hash_byte(hash, WORD_LENGTH);
+    hash_word_list(hash, possible_guesses);
+    hash_word_list(hash, possible_answers);
+    return hash;
+}
+
+std::vector<std::size_t> get_shard_guess_indexes(
+    std::size_t num_guesses,
+    uint32_t shard_index,
+    uint32_t num_shards
+) {
+    std::vector<std::size_t> guess_indexes;
+    for (std::size_t guess_index = shard_index; guess_index < num_guesses; guess_index += num_shards) {
+        guess_indexes.push_back(guess_index);
+    }
+    return guess_indexes;
+}
+
+template <typename T>
+static void write_value(std::ofstream& fout, const T& value) {
+    fout.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+static void read_value(std::ifstream& fin, T& value, const std::string& filename) {
+    fin.read(reinterpret_cast<char*>(&value), sizeof(value));
+    if (!fin) {
+        throw std::runtime_error(std::string("Truncated partial results file ") + filename);
+    }
+}
+
+void replace_file(const std::string& temp_filename, const std::string& filename) {
+    // Unlike std::rename, this replaces an existing file on Windows too
+    // (MoveFileEx with MOVEFILE_REPLACE_EXISTING), and atomically on POSIX
+    std::error_code error;
+    std::filesystem::rename(temp_filename, filename, error);
+    if (error) {
+        throw std::runtime_error(
+            std::string("Could not rename ") + temp_filename + " to " + filename + ": " + error.message()
+        );
+    }
+}
+
+void write_partial_results(const std::string& filename, const PartialResults& partial_results) {
+    ProfileTimer timer(PROFILE_IO);
+    // Written to a temporary and renamed, so a killed shard never leaves a
+    // half written file that looks finished.
+    std::string temp_filename = filename + ".tmp";
+    {
+        std::ofstream fout(temp_filename, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!fout.is_open()) {
+            throw std::runtime_error(std::string("Could not open file ") + temp_filename);
+        }
+
+        fout.write(PARTIAL_RESULTS_MAGIC, sizeof(PARTIAL_RESULTS_MAGIC));
+        write_value(fout, partial_results.dictionary_hash);
+        write_value(fout, partial_results.shard_index);
+        write_value(fout, partial_results.num_shards);
+        write_value(fout, partial_results.num_guesses);
+        write_value(fout, partial_results.num_answers);
+        write_value(fout, (uint64_t) partial_results.results.size());
+        for (const auto& result : partial_results.results) {
+            write_value(fout, result.guess_index);
+            write_value(fout, result.stats.mean);
+            write_value(fout, result.stats.median);
+            write_value(fout, result.stats.stddev);
+        }
+        if (!fout) {
+            throw std::runtime_error(std::string("Could not write file ") + temp_filename);
+        }
+    }
+    replace_file(temp_filename, filename);
+}
+
+PartialResults read_partial_results(const std::string& filename) {
+    ProfileTimer timer(PROFILE_IO);
+    std::ifstream fin(filename, std::ios::in | std::ios::binary);
+    if (!fin.is_open()) {
+        throw std::runtime_error(std::string("Could not open file ") + filename);
+    }
+
+    char magic[sizeof(PARTIAL_RESULTS_MAGIC)];
+    fin.read(magic, sizeof(magic));
+    if (!fin || std::memcmp(magic, PARTIAL_RESULTS_MAGIC, sizeof(magic))) {
+        throw std::runtime_error(filename + " is not a partial results file");
+    }
+
+    PartialResults partial_results;
+    uint64_t num_results;
+    read_value(fin, partial_results.dictionary_hash, filename);
+    read_value(fin, partial_results.shard_index, filename);
+    read_value(fin, partial_results.num_shards, filename);
+    read_value(fin, partial_results.num_guesses, filename);
+    read_value(fin, partial_results.num_answers, filename);
+    read_value(fin, num_results, filename);
+    if (
+        partial_results.num_shards == 0
+        || partial_results.shard_index >= partial_results.num_shards
+    ) {
+        throw std::runtime_error(filename + " has a bad shard number");
+    }
+    if (num_results > partial_results.num_guesses) {
+        throw std::runtime_error(filename + " has more results than guesses");
+    }
+
+    partial_results.results.resize(num_results);
+    for (auto& result : partial_results.results) {
+        read_value(fin, result.guess_index, filename);
+        read_value(fin, result.stats.mean, filename);
+        read_value(fin, result.stats.median, filename);
+        read_value(fin, result.stats.stddev, filename);
+    }
+    return partial_results;
+}
+
+std::vector<GuessStats> merge_partial_results(
+    const std::vector<PartialResults>& shards,
+    uint64_t expected_dictionary_hash,
+    std::size_t num_guesses
+) {
+    if (shards.empty()) {
+        throw std::runtime_error("No partial results to merge");
+    }
+
+    const uint32_t num_shards = shards.front().num_shards;
+    std::vector<bool> is_shard_seen(num_shards, false);
+    for (const auto& shard : shards) {
+        if (shard.dictionary_hash != expected_dictionary_hash) {
+            throw std::runtime_error(
+                "Partial results for shard " + std::to_string(shard.shard_index)
+                + " were made with different word lists"
+            );
+        }
+        if (shard.num_shards != num_shards || shard.shard_index >= num_shards) {
+            throw std::runtime_error("Partial results are from different numbers of shards");
+        }
+        if (is_shard_seen[shard.shard_index]) {
+            throw std::runtime_error(
+                "Shard " + std::to_string(shard.shard_index) + " supplied twice"
+            );
+        }
+        is_shard_seen[shard.shard_index] = true;
+    }
+    for (uint32_t shard_index = 0; shard_index < num_shards; shard_index++) {
+        if (!is_shard_seen[shard_index]) {
+            throw std::runtime_error("Missing shard " + std::to_string(shard_index));
+        }
+    }
+
+    std::vector<GuessStats> guess_index_to_stats(num_guesses);
+    std::vector<bool> is_guess_seen(num_guesses, false);
+    std::size_t num_seen = 0;
+    for (const auto& shard : shards) {
+        for (const auto& result : shard.results) {
+            if (result.guess_index >= num_guesses || is_guess_seen[result.guess_index]) {
+                throw std::runtime_error("Partial results have a bad or repeated guess index");
+            }
+            is_guess_seen[result.guess_index] = true;
+            guess_index_to_stats[result.guess_index] = result.stats;
+            num_seen++;
+        }
+    }
+    if (num_seen != num_guesses) {
+        throw std::runtime_error(
+            "Partial results cover " + std::to_string(num_seen) + " of "
+            + std::to_string(num_guesses) + " guesses"
+        );
+    }
+    return guess_index_to_stats;
+}
@@ -0,0 +1,60 @@
+#ifndef partial_results_hpp
+#define partial_results_hpp
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+#include "get_suggestion.hpp"
+#include "common.hpp"
+
+// Binary files of per-guess stats for part of a search, so that a search can be
+// split up over several processes/machines (--shard) and put back together
+// afterwards (--merge). Stored in the byte order of the machine that wrote them.
+
+// Changes if either list (or their order) changes, so results computed against
+// different word lists can't be mixed up.
+uint64_t hash_word_lists(
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers
+);
+
+struct GuessResult {
+    uint32_t guess_index;
+    GuessStats stats;
+};
+
+struct PartialResults {
+    uint64_t dictionary_hash = 0;
+    uint32_t shard_index = 0;
+    uint32_t num_shards = 1;
+    uint64_t num_guesses = 0;   // in the whole guess list, not just this shard
+    uint64_t num_answers = 0;
+    std::vector<GuessResult> results;
+};
+
+// Deterministic slice of the guess list for shard shard_index of num_shards.
+// Strided rather than contiguous, since nearby guesses tend to cost about the same.
+std::vector<std::size_t> get_shard_guess_indexes(
+    std::size_t num_guesses,
+    uint32_t shard_index,
+    uint32_t num_shards
+);
+
+// Moves temp_filename over filename in one step, so there's never a moment
+// with neither file (or half of one). Throws std::runtime_error if it can't.
+void replace_file(const std::string& temp_filename, const std::string& filename);
+
+void write_partial_results(const std::string& filename, const PartialResults& partial_results);
+PartialResults read_partial_results(const std::string& filename);
+
+// Checks that the shards were made from the same word lists and cover every guess
+// exactly once, and returns the stats indexed by guess index. Throws
+// std::runtime_error otherwise.
+std::vector<GuessStats> merge_partial_results(
+    const std::vector<PartialResults>& shards,
+    uint64_t expected_dictionary_hash,
+    std::size_t num_guesses
+);
+
+#endif
@@ -0,0 +1,297 @@
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+
+#include "profiler.hpp"
+
+bool g_profiling_enabled = false;
+
+static std::mutex registry_mutex;
+static std::vector<std::unique_ptr<ThreadProfile>> thread_profiles;
+
+static uint64_t num_parallel_loops = 0;
+static uint64_t parallel_loop_items = 0;
+static uint64_t parallel_loop_wall_cycles = 0;
+
+static uint64_t start_cycles = 0;
+static std::chrono::steady_clock::time_point start_time;
+
+ThreadProfile& get_thread_profile() {
+    thread_local ThreadProfile* profile = nullptr;
+    if (profile == nullptr) {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        thread_profiles.push_back(std::make_unique<ThreadProfile>());
+        profile = thread_profiles.back().get();
+    }
+    return *profile;
+}
+
+void enable_profiling() {
+    start_time = std::chrono::steady_clock::now();
+    start_cycles = read_cycle_counter();
+    g_profiling_enabled = true;
+}
+
+void record_parallel_loop(uint64_t num_items, uint64_t wall_cycles) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    num_parallel_loops++;
+    parallel_loop_items += num_items;
+    parallel_loop_wall_cycles += wall_cycles;
+}
+
+// Response kernel work done by the threads --numa pinned to one node. Rates are
+// in guess/answer pairs per second of one thread's time in the kernel, so they
+// compare directly with the unpinned baseline whatever the thread counts.
+struct NumaNodeSummary {
+    int32_t node_id = 0;
+    std::size_t num_threads = 0;
+    uint64_t pairs = 0;
+    double kernel_seconds = 0;
+    double pairs_per_second = 0;
+    double gain = 0;  // pairs_per_second / the unpinned baseline's
+};
+
+// Everything needed by both report formats, with cycles already summed over threads
+struct ProfileSummary {
+    double wall_seconds = 0;
+    double cycles_per_second = 1;
+    ThreadProfile totals;
+    std::vector<ThreadProfile> loop_threads;  // only threads that ran guess loop iterations
+    double max_busy_seconds = 0;
+    double mean_busy_seconds = 0;
+    double loop_wall_seconds = 0;
+    double efficiency = 0;
+    std::vector<NumaNodeSummary> numa_nodes;  // empty unless --numa pinned anything
+    uint64_t unpinned_pairs = 0;
+    double unpinned_kernel_seconds = 0;
+    double unpinned_pairs_per_second = 0;
+    double numa_pairs_per_second = 0;  // all nodes together
+    double numa_gain = 0;              // numa_pairs_per_second / unpinned_pairs_per_second
+};
+
+static ProfileSummary summarize() {
+    ProfileSummary summary;
+    double wall_seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start_time
+    ).count();
+    uint64_t elapsed_cycles = read_cycle_counter() - start_cycles;
+    summary.wall_seconds = wall_seconds;
+    if (wall_seconds > 0 && elapsed_cycles > 0) {
+        summary.cycles_per_second = elapsed_cycles / wall_seconds;
+    }
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (const auto& profile : thread_profiles) {
+        for (int section = 0; section < NUM_PROFILE_SECTIONS; section++) {
+            summary.totals.cycles[section] += profile->cycles[section];
+            summary.totals.calls[section] += profile->calls[section];
+        }
+        summary.totals.loop_items += profile->loop_items;
+        summary.totals.loop_busy_cycles += profile->loop_busy_cycles;
+        if (profile->loop_items) {
+            summary.loop_threads.push_back(*profile);
+        }
+    }
+
+    summary.loop_wall_seconds = parallel_loop_wall_cycles / summary.cycles_per_second;
+    for (const auto& profile : summary.loop_threads) {
+        double busy_seconds = profile.loop_busy_cycles / summary.cycles_per_second;
+        summary.max_busy_seconds = std::max(summary.max_busy_seconds, busy_seconds);
+        summary.mean_busy_seconds += busy_seconds;
+    }
+    if (!summary.loop_threads.empty()) {
+        summary.mean_busy_seconds /= summary.loop_threads.size();
+    }
+    if (summary.loop_wall_seconds > 0) {
+        summary.efficiency = (
+            summary.mean_busy_seconds / summary.loop_wall_seconds
+        );
+    }
+
+    uint64_t numa_pairs = 0;
+    double numa_kernel_seconds = 0;
+    for (const auto& profile : summary.loop_threads) {
+        summary.unpinned_pairs += profile.unpinned_pairs;
+        summary.unpinned_kernel_seconds += profile.unpinned_cycles / summary.cycles_per_second;
+        if (profile.numa_node < 0 || profile.pinned_pairs == 0) {
+            continue;
+        }
+        auto found = std::find_if(
+            summary.numa_nodes.begin(),
+            summary.numa_nodes.end(),
+            [&](const NumaNodeSummary& node) {return node.node_id == profile.numa_node; }
+        );
+        if (found == summary.numa_nodes.end()) {
+            summary.numa_nodes.push_back({profile.numa_node});
+            found = summary.numa_nodes.end() - 1;
+        }
+        found->num_threads++;
+        found->pairs += profile.pinned_pairs;
+        found->kernel_seconds += profile.pinned_cycles / summary.cycles_per_second;
+    }
+    std::sort(
+        summary.numa_nodes.begin(),
+        summary.numa_nodes.end(),
+        [](const NumaNodeSummary& node1, const NumaNodeSummary& node2) {return node1.node_id < node2.node_id; }
+    );
+    if (summary.unpinned_kernel_seconds > 0) {
+        summary.unpinned_pairs_per_second = summary.unpinned_pairs / summary.unpinned_kernel_seconds;
+    }
+    for (auto& node : summary.numa_nodes) {
+        if (node.kernel_seconds > 0) {
+            node.pairs_per_second = node.pairs / node.kernel_seconds;
+        }
+        if (summary.unpinned_pairs_per_second > 0) {
+            node.gain = node.pairs_per_second / summary.unpinned_pairs_per_second;
+        }
+        numa_pairs += node.pairs;
+        numa_kernel_seconds += node.kernel_seconds;
+    }
+    if (numa_kernel_seconds > 0) {
+        summary.numa_pairs_per_second = numa_pairs / numa_kernel_seconds;
+    }
+    if (summary.unpinned_pairs_per_second > 0) {
+        summary.numa_gain = summary.numa_pairs_per_second / summary.unpinned_pairs_per_second;
+    }
+    return summary;
+}
+
+void print_profile_report(std::ostream& out) {
+    ProfileSummary summary = summarize();
+    uint64_t total_section_cycles = 0;
+    for (auto cycles : summary.totals.cycles) total_section_cycles += cycles;
+
+    out << "\nPROFILE (wall " << std::fixed << std::setprecision(3) << summary.wall_seconds
+        << " s, counter ~" << std::setprecision(2) << summary.cycles_per_second / 1e9 << " GHz)\n"
+        << "   Section            |        Calls |  CPU seconds | Share  |\n"
+        << "  ------------------------------------------------------------\n";
+    for (int section = 0; section < NUM_PROFILE_SECTIONS; section++) {
+        out << "   " << std::left << std::setw(18) << PROFILE_SECTION_NAMES[section] << std::right
+            << " | " << std::setw(12) << summary.totals.calls[section]
+            << " | " << std::setw(12) << std::setprecision(4)
+            << summary.totals.cycles[section] / summary.cycles_per_second
+            << " | " << std::setw(5) << std::setprecision(1)
+            << (
+                total_section_cycles
+                ? 100.0 * summary.totals.cycles[section] / total_section_cycles
+                : 0.0
+            ) << "% |\n";
+    }
+
+    out << "\nGUESS LOOP LOAD BALANCE (" << num_parallel_loops << " loops, "
+        << parallel_loop_items << " guesses, " << std::setprecision(3)
+        << summary.loop_wall_seconds << " s wall):\n"
+        << "   Thread | Guesses    | Busy seconds |\n"
+        << "  -------------------------------------\n";
+    std::size_t thread_index = 0;
+    for (const auto& profile : summary.loop_threads) {
+        out << "   " << std::setw(6) << thread_index
+            << " | " << std::setw(10) << profile.loop_items
+            << " | " << std::setw(12) << std::setprecision(4)
+            << profile.loop_busy_cycles / summary.cycles_per_second << " |\n";
+        thread_index++;
+    }
+    out << "   Imbalance (max busy / mean busy): " << std::setprecision(3)
+        << (summary.mean_busy_seconds > 0 ? summary.max_busy_seconds / summary.mean_busy_seconds : 0.0)
+        << "\n   Efficiency (mean busy / wall):    " << std::setprecision(1)
+        << 100 * summary.efficiency << "%" << std::endl;
+
+    if (!summary.numa_nodes.empty()) {
+        out << "\nNUMA NODES (response kernel, M pairs/s per thread):\n"
+            << "   Node | Threads | M pairs    | Kernel secs  | M pairs/s | vs unpinned |\n"
+            << "  -------------------------------------------------------------------\n";
+        for (const auto& node : summary.numa_nodes) {
+            out << "   " << std::setw(4) << node.node_id
+                << " | " << std::setw(7) << node.num_threads
+                << " | " << std::setw(10) << std::setprecision(2) << node.pairs / 1e6
+                << " | " << std::setw(12) << std::setprecision(4) << node.kernel_seconds
+                << " | " << std::setw(9) << std::setprecision(2) << node.pairs_per_second / 1e6
+                << " | " << std::setw(10) << std::setprecision(3) << node.gain << "x |\n";
+        }
+        out << "   Unpinned baseline: " << std::setprecision(2) << summary.unpinned_pairs_per_second / 1e6
+            << " M pairs/s over " << std::setprecision(4) << summary.unpinned_kernel_seconds
+            << " kernel seconds (a sample of tiles, unpinned, one copy of the answers)\n"
+            << "   All nodes: " << std::setprecision(2) << summary.numa_pairs_per_second / 1e6
+            << " M pairs/s, " << std::setprecision(3) << summary.numa_gain
+            << "x the unpinned baseline" << std::endl;
+    }
+    out.unsetf(std::ios::fixed);
+}
+
+void write_profile_json(const std::string& filename) {
+    ProfileSummary summary = summarize();
+    std::ofstream fout(filename);
+    if (!fout.is_open()) {
+        throw std::runtime_error(std::string("Could not open file ") + filename);
+    }
+
+    fout << std::setprecision(9)
+        << "{\n  \"wall_seconds\": " << summary.wall_seconds
+        << ",\n  \"counter_hz\": " << summary.cycles_per_second
+        << ",\n  \"sections\": {";
+    for (int section = 0; section < NUM_PROFILE_SECTIONS; section++) {
+        fout << (section ? "," : "") << "\n    \"" << PROFILE_SECTION_NAMES[section] << "\": {"
+            << "\"calls\": " << summary.totals.calls[section]
+            << ", \"cycles\": " << summary.totals.cycles[section]
+            << ", \"cpu_seconds\": " << summary.totals.cycles[section] / summary.cycles_per_second
+            << "}";
+    }
+    fout << "\n  },\n  \"guess_loops\": {"
+        << "\n    \"count\": " << num_parallel_loops
+        << ",\n    \"guesses\": " << parallel_loop_items
+        << ",\n    \"wall_seconds\": " << summary.loop_wall_seconds
+        << ",\n    \"imbalance\": "
+        << (summary.mean_busy_seconds > 0 ? summary.max_busy_seconds / summary.mean_busy_seconds : 0.0)
+        << ",\n    \"efficiency\": " << summary.efficiency
+        << ",\n    \"threads\": [";
+    bool is_first = true;
+    for (const auto& profile : summary.loop_threads) {
+        fout << (is_first ? "" : ",") << "\n      {\"guesses\": " << profile.loop_items
+            << ", \"busy_seconds\": " << profile.loop_busy_cycles / summary.cycles_per_second << "}";
+        is_first = false;
+    }
+    fout << "\n    ]\n  },\n  \"numa_nodes\": [";
+    is_first = true;
+    for (const auto& node : summary.numa_nodes) {
+        fout << (is_first ? "" : ",") << "\n    {\"node\": " << node.node_id
+            << ", \"threads\": " << node.num_threads
+            << ", \"pairs\": " << node.pairs
+            << ", \"kernel_seconds\": " << node.kernel_seconds
+            << ", \"pairs_per_second\": " << node.pairs_per_second
+            << ", \"gain_vs_unpinned\": " << node.gain << "}";
+        is_first = false;
+    }
+    fout << "\n  ],\n  \"numa_unpinned_baseline\": {"
+        << "\"pairs\": " << summary.unpinned_pairs
+        << ", \"kernel_seconds\": " << summary.unpinned_kernel_seconds
+        << ", \"pairs_per_second\": " << summary.unpinned_pairs_per_second << "}"
+        << ",\n  \"numa_pairs_per_second\": " << summary.numa_pairs_per_second
+        << ",\n  \"numa_gain_vs_unpinned\": " << summary.numa_gain << "\n}\n";
+}
+
+ProfileReportGuard::ProfileReportGuard(bool is_enabled, std::string json_filename) :
+    is_enabled(is_enabled),
+    json_filename(std::move(json_filename))
+{
+    if (is_enabled) {
+        enable_profiling();
+    }
+}
+
+ProfileReportGuard::~ProfileReportGuard() {
+    if (!is_enabled) return;
+    print_profile_report(std::cout);
+    if (!json_filename.empty()) {
+        try {
+            write_profile_json(json_filename);
+        } catch (const std::exception& exc) {
+            std::cerr << exc.what() << std::endl;
+        }
+    }
+}
@@ -0,0 +1,122 @@
+#ifndef profiler_hpp
+#define profiler_hpp
+
+#include <array>
+#include <string>
+#include <ostream>
+#include <stdint.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+// Low overhead instrumentation for --profile. Every thread writes only to its
+// own ThreadProfile, which are summed up when the report is printed, so there
+// is no contention on the hot path. When profiling is off, each timer costs a
+// single well predicted branch.
+
+enum ProfileSection : uint8_t {
+    PROFILE_RESPONSE,
+    PROFILE_RESTRICTION_UPDATE,
+    PROFILE_FILTER,
+    PROFILE_SCORE,
+    PROFILE_SORT,
+    PROFILE_IO,
+    NUM_PROFILE_SECTIONS
+};
+
+constexpr std::array<const char*, NUM_PROFILE_SECTIONS> PROFILE_SECTION_NAMES = {
+    "response",
+    "restriction_update",
+    "filter",
+    "score",
+    "sort",
+    "io"
+};
+
+struct alignas(64) ThreadProfile {
+    std::array<uint64_t, NUM_PROFILE_SECTIONS> cycles = {};
+    std::array<uint64_t, NUM_PROFILE_SECTIONS> calls = {};
+
+    // Load balance info for the guess loop(s) in get_ranked_guesses
+    uint64_t loop_items = 0;
+    uint64_t loop_busy_cycles = 0;
+    // Guess/answer pairs run through the response kernel (whose time is
+    // cycles[PROFILE_RESPONSE]). That costs the same per pair however much
+    // pruning there is, so its rate is what --numa can be judged by.
+    uint64_t response_pairs = 0;
+
+    // The response kernel's share of --numa tiles, as split up by
+    // for_each_tile_by_node: pinned to numa_node, or unpinned and reading one
+    // shared copy of the answers (the baseline)
+    uint64_t pinned_pairs = 0;
+    uint64_t pinned_cycles = 0;
+    uint64_t unpinned_pairs = 0;
+    uint64_t unpinned_cycles = 0;
+
+    // Node the thread was pinned to by --numa, or -1 if it wasn't
+    int32_t numa_node = -1;
+};
+
+extern bool g_profiling_enabled;
+
+inline uint64_t read_cycle_counter() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+// The calling thread's profile, created on first use.
+ThreadProfile& get_thread_profile();
+
+void enable_profiling();
+
+// Records that a parallel loop over num_items took wall_cycles on the calling
+// (master) thread. Used to compute efficiency in the report.
+void record_parallel_loop(uint64_t num_items, uint64_t wall_cycles);
+
+void print_profile_report(std::ostream& out);
+void write_profile_json(const std::string& filename);
+
+class ProfileTimer {
+public:
+    explicit ProfileTimer(ProfileSection section) : section(section) {
+        if (g_profiling_enabled) {
+            start = read_cycle_counter();
+        }
+    }
+    ~ProfileTimer() {
+        if (g_profiling_enabled) {
+            ThreadProfile& profile = get_thread_profile();
+            profile.cycles[section] += read_cycle_counter() - start;
+            profile.calls[section]++;
+        }
+    }
+
+    ProfileTimer(const ProfileTimer&) = delete;
+    ProfileTimer& operator=(const ProfileTimer&) = delete;
+
+private:
+    ProfileSection section;
+    uint64_t start = 0;
+};
+
+// Prints (and optionally writes json) when it goes out of scope, so that
+// every way out of main gets a report.
+class ProfileReportGuard {
+public:
+    ProfileReportGuard(bool is_enabled, std::string json_filename);
+    ~ProfileReportGuard();
+
+private:
+    bool is_enabled;
+    std::string json_filename;
+};
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef response_code_hpp
+#define response_code_hpp
+
+#include <array>
+#include <string>
+#include <stdint.h>
+
+#include "common.hpp"
+
+// A response read as a base 3 number (first position most significant), eg
+// 20100 -> 2*81 + 1*9 = 171. Everything about a response that's needed more than
+// once is looked up in tables built at compile time, indexed by this.
+typedef uint16_t ResponseCode;
+
+constexpr std::size_t calculate_num_responses() {
+    std::size_t num_responses = 1;
+    for (uletter_int index = 0; index < WORD_LENGTH; index++) {
+        num_responses *= 3;
+    }
+    return num_responses;
+}
+
+constexpr std::size_t NUM_RESPONSES = calculate_num_responses();
+constexpr ResponseCode ALL_GREEN_CODE = NUM_RESPONSES - 1;
+
+static_assert(NUM_RESPONSES - 1 <= UINT16_MAX, "Response codes have to fit in a ResponseCode");
+static_assert(WORD_LENGTH <= 8, "Position masks have to fit in a uint8_t");
+
+constexpr ResponseCode response_array_to_code(const ResponseArray& response) {
+    ResponseCode code = 0;
+    for (auto response_val : response) {
+        code = code * 3 + response_val;
+    }
+    return code;
+}
+
+// What a 1 at each position adds to the code
+constexpr std::array<ResponseCode, WORD_LENGTH> make_place_values() {
+    std::array<ResponseCode, WORD_LENGTH> place_values = {};
+    ResponseCode place_value = 1;
+    for (int index = WORD_LENGTH - 1; index >= 0; index--) {
+        place_values[index] = place_value;
+        place_value *= 3;
+    }
+    return place_values;
+}
+
+inline constexpr std::array<ResponseCode, WORD_LENGTH> RESPONSE_PLACE_VALUES = make_place_values();
+
+// Bit i set if position i has that color
+struct ResponseMasks {
+    uint8_t green = 0;
+    uint8_t yellow = 0;
+    uint8_t gray = 0;
+};
+
+constexpr std::array<ResponseArray, NUM_RESPONSES> make_code_to_array_table() {
+    std::array<ResponseArray, NUM_RESPONSES> code_to_array = {};
+    for (std::size_t code = 0; code < NUM_RESPONSES; code++) {
+        std::size_t remaining = code;
+        for (int index = WORD_LENGTH - 1; index >= 0; index--) {
+            code_to_array[code][index] = remaining % 3;
+            remaining /= 3;
+        }
+    }
+    return code_to_array;
+}
+
+constexpr std::array<ResponseMasks, NUM_RESPONSES> make_code_to_masks_table() {
+    constexpr auto code_to_array = make_code_to_array_table();
+    std::array<ResponseMasks, NUM_RESPONSES> code_to_masks = {};
+    for (std::size_t code = 0; code < NUM_RESPONSES; code++) {
+        for (uletter_int index = 0; index < WORD_LENGTH; index++) {
+            switch (code_to_array[code][index]) {
+                case 0: code_to_masks[code].gray |= 1 << index; break;
+                case 1: code_to_masks[code].yellow |= 1 << index; break;
+                case 2: code_to_masks[code].green |= 1 << index; break;
+            }
+        }
+    }
+    return code_to_masks;
+}
+
+inline constexpr std::array<ResponseArray, NUM_RESPONSES> RESPONSE_CODE_TO_ARRAY = make_code_to_array_table();
+inline constexpr std::array<ResponseMasks, NUM_RESPONSES> RESPONSE_CODE_TO_MASKS = make_code_to_masks_table();
+
+static_assert(response_array_to_code(RESPONSE_CODE_TO_ARRAY[171]) == 171);
+static_assert(RESPONSE_CODE_TO_MASKS[ALL_GREEN_CODE].green == (1 << WORD_LENGTH) - 1);
+
+constexpr const ResponseArray& response_code_to_array(ResponseCode code) {
+    return RESPONSE_CODE_TO_ARRAY[code];
+}
+
+constexpr bool is_all_green(ResponseCode code) {
+    return code == ALL_GREEN_CODE;
+}
+
+// Reads a response typed as eg "20100" (2: green, 1: yellow, 0: gray). Returns
+// false, leaving code alone, if it isn't exactly WORD_LENGTH of those digits.
+inline bool parse_response_code(const std::string& text, ResponseCode& code) {
+    if (text.size() != WORD_LENGTH) {
+        return false;
+    }
+    ResponseCode parsed_code = 0;
+    for (char c : text) {
+        if (c < '0' || c > '2') {
+            return false;
+        }
+        parsed_code = parsed_code * 3 + (c - '0');
+    }
+    code = parsed_code;
+    return true;
+}
+
+#endif
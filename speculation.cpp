@@ -0,0 +1,171 @@
+#include <vector>
+#include <map>
+#include <optional>
+#include <algorithm>
+#include <utility>
+
+#include "speculation.hpp"
+#include "get_suggestion.hpp"
+#include "word_restriction.hpp"
+#include "response_code.hpp"
+#include "common.hpp"
+
+TurnResult calculate_turn_result(
+    const WordArray& guess,
+    const ResponseArray& response,
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers,
+    const WordRestriction& restriction,
+    bool is_hard_mode
+) {
+    TurnResult result;
+    result.restriction = restriction;
+    // Responses here come from actual answers, so this only fails on a bug -
+    // no need for the slow path's error messages
+    if (
+        result.restriction.try_update_from_word_guess(guess, response_array_to_code(response))
+        != RESTRICTION_OK
+    ) {
+        throw InvalidRestriction();
+    }
+
+    for (const auto& answer : possible_answers) {
+        if (result.restriction.is_word_allowed(answer)) {
+            result.possible_answers.push_back(answer);
+        }
+    }
+
+    for (const auto& possible_guess : possible_guesses) {
+        if (
+            is_hard_mode
+            ? result.restriction.is_word_allowed(possible_guess)
+            : result.restriction.can_provide_new_information(possible_guess)
+        ) {
+            result.possible_guesses.push_back(possible_guess);
+        }
+    }
+    return result;
+}
+
+SpeculativeTurn::SpeculativeTurn(
+    const WordArray& guess,
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers,
+    const WordRestriction& restriction,
+    std::size_t num_ranked_wanted,
+    bool is_hard_mode
+) :
+    guess(guess),
+    possible_guesses(possible_guesses),
+    possible_answers(possible_answers),
+    restriction(restriction),
+    num_ranked_wanted(num_ranked_wanted),
+    is_hard_mode(is_hard_mode)
+{
+    worker = std::thread(&SpeculativeTurn::_run, this);
+}
+
+SpeculativeTurn::~SpeculativeTurn() {
+    stop_after_current = true;
+    cancel_current = true;
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+std::optional<TurnResult> SpeculativeTurn::claim(const ResponseArray& response) {
+    std::unique_lock<std::mutex> lock(mutex);
+    stop_after_current = true;
+    if (in_progress.has_value() && *in_progress != response) {
+        cancel_current = true;
+    }
+
+    // If the one we want is being worked on, it's going to finish sooner than
+    // starting over would.
+    finished_cv.wait(lock, [&]() {
+        return !(in_progress.has_value() && *in_progress == response);
+    });
+
+    auto found = finished.find(response);
+    if (found == finished.end()) {
+        return std::nullopt;
+    }
+    return std::move(found->second);
+}
+
+void SpeculativeTurn::_run() {
+    // How likely each answer is to be the one - all the same unless weighted
+    const WeightArray answer_weights = get_answer_weights(possible_answers);
+    std::map<ResponseArray, double> response_to_weight;
+    for (std::size_t answer_index = 0; answer_index < possible_answers.size(); answer_index++) {
+        response_to_weight[calculate_response(guess, possible_answers[answer_index])] += (
+            answer_weights.empty() ? 1.0 : answer_weights[answer_index]
+        );
+    }
+
+    // Heaviest buckets first, since these are the responses the user is most
+    // likely to enter
+    std::vector<std::pair<double, ResponseArray>> buckets;
+    for (const auto& [response, weight] : response_to_weight) {
+        buckets.emplace_back(weight, response);
+    }
+    std::stable_sort(
+        buckets.begin(),
+        buckets.end(),
+        [](const auto& bucket1, const auto& bucket2) {return bucket1.first > bucket2.first; }
+    );
+
+    for (const auto& bucket : buckets) {
+        const ResponseArray& response = bucket.second;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stop_after_current) {
+                break;
+            }
+            in_progress = response;
+        }
+
+        TurnResult result;
+        bool is_valid = true;
+        try {
+            result = calculate_turn_result(
+                guess,
+                response,
+                possible_guesses,
+                possible_answers,
+                restriction,
+                is_hard_mode
+            );
+            if (num_ranked_wanted) {
+                result.ranked_guesses = get_top_ranked_guesses(
+                    result.possible_guesses,
+                    result.possible_answers,
+                    result.restriction,
+                    num_ranked_wanted,
+                    &cancel_current,
+                    false
+                );
+            } else {
+                result.ranked_guesses = get_ranked_guesses(
+                    result.possible_guesses,
+                    result.possible_answers,
+                    result.restriction,
+                    &cancel_current,
+                    false
+                );
+            }
+        } catch (const InvalidRestriction&) {
+            is_valid = false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (is_valid && !cancel_current) {
+                finished.emplace(response, std::move(result));
+            }
+            in_progress.reset();
+            cancel_current = false;
+        }
+        finished_cv.notify_all();
+    }
+}
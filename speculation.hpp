@@ -0,0 +1,81 @@
+#ifndef speculation_hpp
+#define speculation_hpp
+
+#include <vector>
+#include <map>
+#include <optional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "word_restriction.hpp"
+#include "get_suggestion.hpp"
+#include "common.hpp"
+
+// Everything the main loop needs after a word/response has been entered.
+struct TurnResult {
+    WordRestriction restriction;
+    std::vector<WordArray> possible_answers;
+    std::vector<WordArray> possible_guesses;
+    std::vector<RankedGuess> ranked_guesses;  // suggestions from possible_guesses
+};
+
+// Applies a guess/response to the current state without printing anything.
+// ranked_guesses is left empty. In hard mode, only guesses that fit every
+// hint so far are kept.
+TurnResult calculate_turn_result(
+    const WordArray& guess,
+    const ResponseArray& response,
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers,
+    const WordRestriction& restriction,
+    bool is_hard_mode = false
+);
+
+// While the user is typing in the response to a guess, work out what the
+// next turn will look like for each response that could come back, starting
+// with the responses shared by the most remaining answers (ie, the most likely).
+class SpeculativeTurn {
+public:
+    // If num_ranked_wanted isn't 0, only that many of the best guesses are
+    // ranked per response (see get_top_ranked_guesses).
+    SpeculativeTurn(
+        const WordArray& guess,
+        const std::vector<WordArray>& possible_guesses,
+        const std::vector<WordArray>& possible_answers,
+        const WordRestriction& restriction,
+        std::size_t num_ranked_wanted = 0,
+        bool is_hard_mode = false
+    );
+    ~SpeculativeTurn();
+
+    SpeculativeTurn(const SpeculativeTurn&) = delete;
+    SpeculativeTurn& operator=(const SpeculativeTurn&) = delete;
+
+    // Stops all speculation that isn't for response. If the result for response
+    // is done (or in progress, in which case this waits for it), returns it.
+    std::optional<TurnResult> claim(const ResponseArray& response);
+
+private:
+    void _run();
+
+    const WordArray guess;
+    const std::vector<WordArray> possible_guesses;
+    const std::vector<WordArray> possible_answers;
+    const WordRestriction restriction;
+    const std::size_t num_ranked_wanted;
+    const bool is_hard_mode;
+
+    std::mutex mutex;
+    std::condition_variable finished_cv;
+    std::map<ResponseArray, TurnResult> finished;
+    std::optional<ResponseArray> in_progress;
+
+    std::atomic_bool stop_after_current = false;
+    std::atomic_bool cancel_current = false;
+
+    std::thread worker;
+};
+
+#endif
@@ -0,0 +1,186 @@
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <utility>
+#include <omp.h>
+
+#include "task_scheduler.hpp"
+
+// Which scheduler (if any) the current thread is a worker of, and its queue
+static thread_local const TaskScheduler* current_scheduler = nullptr;
+static thread_local std::size_t current_queue_index = 0;
+
+TaskGroup::TaskGroup(TaskScheduler& scheduler, const std::atomic_bool* cancel_flag) :
+    scheduler(scheduler),
+    cancel_flag(cancel_flag)
+{}
+
+TaskGroup::~TaskGroup() {
+    // Tasks hold a pointer to their group, so it can't go away before they're done
+    if (num_pending) {
+        try {
+            wait();
+        } catch (...) {}
+    }
+}
+
+void TaskGroup::run(std::function<void()> function) {
+    num_pending++;
+    scheduler._push(TaskScheduler::Task{std::move(function), this});
+}
+
+void TaskGroup::wait() {
+    while (num_pending) {
+        if (!scheduler._try_run_one()) {
+            // Everything left in this group is running on other threads
+            std::this_thread::yield();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(exception_mutex);
+    if (first_exception) {
+        std::exception_ptr exception = first_exception;
+        first_exception = nullptr;
+        std::rethrow_exception(exception);
+    }
+}
+
+void TaskGroup::cancel() {
+    is_group_cancelled = true;
+}
+
+bool TaskGroup::is_cancelled() const {
+    return is_group_cancelled || (cancel_flag != nullptr && *cancel_flag);
+}
+
+void TaskGroup::_finish_task(std::exception_ptr exception) {
+    if (exception) {
+        std::lock_guard<std::mutex> lock(exception_mutex);
+        if (!first_exception) {
+            first_exception = exception;
+        }
+        is_group_cancelled = true;
+    }
+    num_pending--;
+}
+
+TaskScheduler::TaskScheduler(unsigned num_threads) {
+    if (num_threads == 0) {
+        num_threads = omp_get_max_threads();
+    }
+    if (num_threads == 0) {
+        num_threads = 1;
+    }
+
+    for (unsigned queue_index = 0; queue_index < num_threads; queue_index++) {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    for (unsigned queue_index = 1; queue_index < num_threads; queue_index++) {
+        workers.emplace_back(&TaskScheduler::_worker_loop, this, queue_index);
+    }
+}
+
+TaskScheduler::~TaskScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        is_shutting_down = true;
+    }
+    sleep_cv.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+unsigned TaskScheduler::get_num_threads() const {
+    return queues.size();
+}
+
+std::size_t TaskScheduler::_get_queue_index() const {
+    return current_scheduler == this ? current_queue_index : 0;
+}
+
+void TaskScheduler::_push(Task task) {
+    WorkerQueue& queue = *queues[_get_queue_index()];
+    // Counted before it's visible so that a thief can never take it to below 0
+    bool was_empty = num_queued++ == 0;
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    // Only need to wake someone up if they might all be asleep
+    if (was_empty) {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        sleep_cv.notify_all();
+    }
+}
+
+bool TaskScheduler::_try_pop(std::size_t queue_index, bool from_back, Task& dest) {
+    WorkerQueue& queue = *queues[queue_index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    if (from_back) {
+        dest = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+    } else {
+        dest = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+    }
+    num_queued--;
+    return true;
+}
+
+bool TaskScheduler::_try_run_one() {
+    if (!num_queued) {
+        return false;
+    }
+
+    std::size_t own_index = _get_queue_index();
+    Task task;
+    if (_try_pop(own_index, true, task)) {
+        _execute(task);
+        return true;
+    }
+
+    // Steal, starting from the queue after ours so thieves spread out
+    for (std::size_t offset = 1; offset < queues.size(); offset++) {
+        std::size_t victim_index = (own_index + offset) % queues.size();
+        if (_try_pop(victim_index, false, task)) {
+            _execute(task);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TaskScheduler::_execute(Task& task) {
+    std::exception_ptr exception;
+    if (!task.group->is_cancelled()) {
+        try {
+            task.function();
+        } catch (...) {
+            exception = std::current_exception();
+        }
+    }
+    task.group->_finish_task(exception);
+}
+
+void TaskScheduler::_worker_loop(std::size_t queue_index) {
+    current_scheduler = this;
+    current_queue_index = queue_index;
+
+    while (true) {
+        if (_try_run_one()) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        sleep_cv.wait(lock, [&]() { return is_shutting_down || num_queued > 0; });
+        if (is_shutting_down) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef task_scheduler_hpp
+#define task_scheduler_hpp
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <memory>
+#include <atomic>
+#include <stdint.h>
+
+class TaskScheduler;
+
+// A set of tasks that can be waited on together. Tasks may spawn more tasks
+// into the same or a nested group; waiting never blocks a thread, it just runs
+// other queued tasks until the group is finished.
+//
+// If cancel_flag is set (or cancel() is called), tasks in the group that have
+// not started yet are skipped. Long running tasks should check is_cancelled()
+// themselves.
+class TaskGroup {
+public:
+    explicit TaskGroup(TaskScheduler& scheduler, const std::atomic_bool* cancel_flag = nullptr);
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void run(std::function<void()> function);
+
+    // Helps run tasks until everything in this group is done. Rethrows the first
+    // exception thrown by any task in the group.
+    void wait();
+
+    void cancel();
+    bool is_cancelled() const;
+
+private:
+    friend class TaskScheduler;
+
+    void _finish_task(std::exception_ptr exception);
+
+    TaskScheduler& scheduler;
+    const std::atomic_bool* cancel_flag;
+    std::atomic_bool is_group_cancelled = false;
+    std::atomic<int64_t> num_pending = 0;
+
+    std::mutex exception_mutex;
+    std::exception_ptr first_exception;
+};
+
+// Work stealing thread pool. Every thread has its own deque: it pushes and pops
+// new tasks at the back (depth first, so nested work stays hot in cache and
+// memory stays bounded), and idle threads steal from the front of other deques,
+// which is where the oldest, and usually biggest, pieces of work are.
+//
+// The thread calling TaskGroup::wait counts as one of the workers, so
+// num_threads - 1 threads are started and the machine isn't oversubscribed.
+class TaskScheduler {
+public:
+    // num_threads == 0 means use omp_get_max_threads(), so OMP_NUM_THREADS is respected
+    explicit TaskScheduler(unsigned num_threads = 0);
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    unsigned get_num_threads() const;
+
+private:
+    friend class TaskGroup;
+
+    struct Task {
+        std::function<void()> function;
+        TaskGroup* group;
+    };
+
+    struct alignas(64) WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void _push(Task task);
+    bool _try_run_one();
+    bool _try_pop(std::size_t queue_index, bool from_back, Task& dest);
+    void _execute(Task& task);
+    void _worker_loop(std::size_t queue_index);
+    std::size_t _get_queue_index() const;
+
+    // Index 0 is shared by any threads that are not workers of this scheduler
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+
+    std::atomic<int64_t> num_queued = 0;
+    std::atomic_bool is_shutting_down = false;
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_cv;
+};
+
+#endif
@@ -0,0 +1,434 @@
+#include <vector>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <mutex>
+#include <stdint.h>
+
+#include "verify.hpp"
+#include "alphabet.hpp"
+#include "get_suggestion.hpp"
+#include "word_restriction.hpp"
+#include "response_code.hpp"
+#include "word_table.hpp"
+#include "word_trie.hpp"
+#include "common.hpp"
+
+static constexpr std::size_t MAX_MISMATCHES_SHOWN = 5;
+static constexpr uint32_t MAX_TURNS_PER_GAME = 6;
+// One turn in this many gets a random response instead of the real one
+static constexpr uint32_t RANDOM_RESPONSE_ODDS = 4;
+
+typedef std::chrono::steady_clock Clock;
+
+// How one optimized kernel compared to its reference
+struct KernelCheck {
+    std::string name;
+    std::string unit;  // what num_checked counts
+    uint64_t num_checked = 0;
+    uint64_t num_mismatches = 0;
+    std::vector<std::string> first_mismatches;
+    double reference_seconds = 0;
+    double optimized_seconds = 0;
+    std::mutex mutex;
+
+    KernelCheck(std::string name, std::string unit) : name(std::move(name)), unit(std::move(unit)) {}
+
+    void add_mismatch(const std::string& description) {
+        std::lock_guard<std::mutex> lock(mutex);
+        num_mismatches++;
+        if (first_mismatches.size() < MAX_MISMATCHES_SHOWN) {
+            first_mismatches.push_back(description);
+        }
+    }
+
+    void add_times(uint64_t num, double reference, double optimized) {
+        std::lock_guard<std::mutex> lock(mutex);
+        num_checked += num;
+        reference_seconds += reference;
+        optimized_seconds += optimized;
+    }
+};
+
+static double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static std::string response_code_to_string(ResponseCode response_code) {
+    std::string response_str;
+    for (auto response_val : response_code_to_array(response_code)) {
+        response_str += (char) ('0' + response_val);
+    }
+    return response_str;
+}
+
+static std::string letters_to_string(const LetterMask& letters) {
+    std::string letters_str;
+    for (LetterMask remaining = letters; remaining != NO_LETTERS; remaining = without_lowest_letter(remaining)) {
+        letters_str += get_alphabet().get_letter_string(get_lowest_letter(remaining));
+    }
+    return letters_str;
+}
+
+// Everything that differs between two restrictions, eg "max e: 1 vs 0"
+static std::string describe_difference(const WordRestriction& reference, const WordRestriction& optimized) {
+    std::stringstream description;
+    for (uletter_int letter = 0; letter < ALPHABET_LENGTH; letter++) {
+        if (reference.min_possible[letter] != optimized.min_possible[letter]) {
+            description << " min " << get_alphabet().get_letter_string(letter) << ": "
+                << (int) reference.min_possible[letter] << " vs " << (int) optimized.min_possible[letter] << ";";
+        }
+        if (reference.max_possible[letter] != optimized.max_possible[letter]) {
+            description << " max " << get_alphabet().get_letter_string(letter) << ": "
+                << (int) reference.max_possible[letter] << " vs " << (int) optimized.max_possible[letter] << ";";
+        }
+    }
+    for (uletter_int index = 0; index < WORD_LENGTH; index++) {
+        if (reference.pos_to_allowed[index] != optimized.pos_to_allowed[index]) {
+            description << " allowed at " << (int) index << ": "
+                << letters_to_string(reference.pos_to_allowed[index]) << " vs "
+                << letters_to_string(optimized.pos_to_allowed[index]) << ";";
+        }
+    }
+    return description.str();
+}
+
+static bool restrictions_match(const WordRestriction& restriction1, const WordRestriction& restriction2) {
+    return (
+        restriction1.min_possible == restriction2.min_possible
+        && restriction1.max_possible == restriction2.max_possible
+        && restriction1.pos_to_allowed == restriction2.pos_to_allowed
+    );
+}
+
+// Every guess against every answer, one guess per omp iteration. Each side does
+// a whole guess's answers at a time, so the timing is of the kernel, not of
+// switching back and forth.
+static void check_all_pairs(
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers,
+    KernelCheck& response_check,
+    KernelCheck& update_check
+) {
+    const int64_t num_guesses = possible_guesses.size();
+    const std::size_t num_answers = possible_answers.size();
+
+    // guess_index is signed to make omp happy
+    #pragma omp parallel
+    {
+        std::vector<ResponseCode> reference_codes(num_answers);
+        std::vector<ResponseCode> optimized_codes(num_answers);
+        std::vector<WordRestriction> reference_restrictions(num_answers);
+        std::vector<WordRestriction> optimized_restrictions(num_answers);
+        std::vector<RestrictionStatus> statuses(num_answers);
+        double response_reference_seconds = 0, response_optimized_seconds = 0;
+        double update_reference_seconds = 0, update_optimized_seconds = 0;
+
+        #pragma omp for schedule(dynamic)
+        for (int64_t guess_index = 0; guess_index < num_guesses; guess_index++) {
+            const WordArray& guess = possible_guesses[guess_index];
+
+            auto start = Clock::now();
+            for (std::size_t answer_index = 0; answer_index < num_answers; answer_index++) {
+                reference_codes[answer_index] = response_to_index(
+                    calculate_response(guess, possible_answers[answer_index])
+                );
+            }
+            response_reference_seconds += seconds_since(start);
+
+            start = Clock::now();
+            for (std::size_t answer_index = 0; answer_index < num_answers; answer_index++) {
+                optimized_codes[answer_index] = calculate_response_code(guess, possible_answers[answer_index]);
+            }
+            response_optimized_seconds += seconds_since(start);
+
+            start = Clock::now();
+            for (std::size_t answer_index = 0; answer_index < num_answers; answer_index++) {
+                reference_restrictions[answer_index] = WordRestriction();
+                reference_restrictions[answer_index].update_from_word_guess(
+                    guess,
+                    response_code_to_array(reference_codes[answer_index])
+                );
+            }
+            update_reference_seconds += seconds_since(start);
+
+            start = Clock::now();
+            for (std::size_t answer_index = 0; answer_index < num_answers; answer_index++) {
+                optimized_restrictions[answer_index] = WordRestriction();
+                statuses[answer_index] = optimized_restrictions[answer_index].try_update_from_word_guess(
+                    guess,
+                    reference_codes[answer_index]
+                );
+            }
+            update_optimized_seconds += seconds_since(start);
+
+            for (std::size_t answer_index = 0; answer_index < num_answers; answer_index++) {
+                // Only wanted for mismatches, so only made for them
+                auto get_pair_str = [&]() {
+                    return word_vec_to_string(guess) + " / " + word_vec_to_string(possible_answers[answer_index]);
+                };
+                if (reference_codes[answer_index] != optimized_codes[answer_index]) {
+                    response_check.add_mismatch(
+                        get_pair_str() + ": " + response_code_to_string(reference_codes[answer_index])
+                        + " vs " + response_code_to_string(optimized_codes[answer_index])
+                    );
+                }
+                if (statuses[answer_index] != RESTRICTION_OK) {
+                    update_check.add_mismatch(
+                        get_pair_str() + ": status " + std::to_string(statuses[answer_index])
+                        + " for a real response"
+                    );
+                } else if (
+                    !restrictions_match(reference_restrictions[answer_index], optimized_restrictions[answer_index])
+                ) {
+                    update_check.add_mismatch(
+                        get_pair_str() + ":" + describe_difference(
+                            reference_restrictions[answer_index],
+                            optimized_restrictions[answer_index]
+                        )
+                    );
+                }
+            }
+        }
+
+        // Counts are added once below, only the times are per thread
+        response_check.add_times(0, response_reference_seconds, response_optimized_seconds);
+        update_check.add_times(0, update_reference_seconds, update_optimized_seconds);
+    }
+    response_check.num_checked += (uint64_t) num_guesses * num_answers;
+    update_check.num_checked += (uint64_t) num_guesses * num_answers;
+}
+
+// Indexes of the words reference_restriction allows, the slow way
+static std::vector<uint32_t> get_reference_indexes(
+    const WordRestriction& restriction,
+    const std::vector<WordArray>& words
+) {
+    std::vector<uint32_t> indexes;
+    for (std::size_t word_index = 0; word_index < words.size(); word_index++) {
+        if (restriction.is_word_allowed(words[word_index])) {
+            indexes.push_back(word_index);
+        }
+    }
+    return indexes;
+}
+
+struct FilterChecks {
+    KernelCheck& table_check;
+    KernelCheck& trie_check;
+};
+
+static void check_filters(
+    const std::string& history,
+    const WordRestriction& restriction,
+    const std::vector<WordArray>& words,
+    const WordTable& table,
+    const WordTrie& trie,
+    FilterChecks& checks
+) {
+    auto start = Clock::now();
+    std::vector<uint32_t> reference_indexes = get_reference_indexes(restriction, words);
+    double reference_seconds = seconds_since(start);
+
+    start = Clock::now();
+    std::vector<uint32_t> table_indexes;
+    table.get_surviving_indexes(restriction, table_indexes);
+    double table_seconds = seconds_since(start);
+
+    start = Clock::now();
+    std::vector<WordArray> trie_words = trie.get_matching_words(restriction);
+    double trie_seconds = seconds_since(start);
+
+    checks.table_check.add_times(words.size(), reference_seconds, table_seconds);
+    checks.trie_check.add_times(words.size(), reference_seconds, trie_seconds);
+
+    if (table_indexes != reference_indexes) {
+        checks.table_check.add_mismatch(
+            history + ": " + std::to_string(reference_indexes.size()) + " words allowed vs "
+            + std::to_string(table_indexes.size())
+        );
+    }
+
+    std::vector<WordArray> reference_words;
+    for (auto word_index : reference_indexes) {
+        reference_words.push_back(words[word_index]);
+    }
+    // The trie hands them back in its own order
+    std::sort(reference_words.begin(), reference_words.end());
+    std::sort(trie_words.begin(), trie_words.end());
+    if (trie_words != reference_words) {
+        checks.trie_check.add_mismatch(
+            history + ": " + std::to_string(reference_words.size()) + " words allowed vs "
+            + std::to_string(trie_words.size())
+        );
+    }
+}
+
+// Plays num_games games from an empty restriction, with the reference update
+// and both code based updates side by side, and checks the filters on the
+// state after every turn that all three agree is still possible.
+static void check_random_games(
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers,
+    uint32_t num_games,
+    uint32_t seed,
+    KernelCheck& try_update_check,
+    KernelCheck& code_update_check,
+    FilterChecks& filter_checks
+) {
+    const WordTable guess_table(possible_guesses);
+    const WordTable answer_table(possible_answers);
+    const WordTrie guess_trie(possible_guesses);
+    const WordTrie answer_trie(possible_answers);
+
+    // The reference update prints why a response is impossible before throwing,
+    // which would bury the report under the made up responses' errors
+    std::streambuf* cerr_buffer = std::cerr.rdbuf(nullptr);
+
+    std::mt19937 rng(seed);
+    for (uint32_t game_index = 0; game_index < num_games; game_index++) {
+        const WordArray& answer = possible_answers[rng() % possible_answers.size()];
+        WordRestriction reference, try_restriction, code_restriction;
+        std::string history = "answer " + word_vec_to_string(answer) + ":";
+        uint32_t num_turns = 1 + rng() % MAX_TURNS_PER_GAME;
+
+        for (uint32_t turn = 0; turn < num_turns; turn++) {
+            const WordArray& guess = possible_guesses[rng() % possible_guesses.size()];
+            ResponseCode response_code = (
+                rng() % RANDOM_RESPONSE_ODDS
+                ? calculate_response_code(guess, answer)
+                : (ResponseCode) (rng() % NUM_RESPONSES)
+            );
+            history += " " + word_vec_to_string(guess) + " " + response_code_to_string(response_code);
+
+            auto start = Clock::now();
+            bool is_reference_valid = true;
+            try {
+                reference.update_from_word_guess(guess, response_code_to_array(response_code));
+            } catch (const InvalidRestriction&) {
+                is_reference_valid = false;
+            }
+            double reference_seconds = seconds_since(start);
+
+            start = Clock::now();
+            bool is_try_valid = try_restriction.try_update_from_word_guess(guess, response_code) == RESTRICTION_OK;
+            double try_seconds = seconds_since(start);
+
+            start = Clock::now();
+            bool is_code_valid = true;
+            try {
+                code_restriction.update_from_word_guess(guess, response_code);
+            } catch (const InvalidRestriction&) {
+                is_code_valid = false;
+            }
+            double code_seconds = seconds_since(start);
+
+            try_update_check.add_times(1, reference_seconds, try_seconds);
+            code_update_check.add_times(1, reference_seconds, code_seconds);
+
+            auto compare = [&](
+                KernelCheck& check,
+                bool is_valid,
+                const WordRestriction& restriction
+            ) {
+                if (is_valid != is_reference_valid) {
+                    check.add_mismatch(
+                        history + std::string(": reference says ")
+                        + (is_reference_valid ? "possible" : "impossible")
+                    );
+                    return false;
+                }
+                if (is_valid && !restrictions_match(reference, restriction)) {
+                    check.add_mismatch(history + ":" + describe_difference(reference, restriction));
+                    return false;
+                }
+                return true;
+            };
+            bool is_try_match = compare(try_update_check, is_try_valid, try_restriction);
+            bool is_code_match = compare(code_update_check, is_code_valid, code_restriction);
+            if (!is_reference_valid || !is_try_match || !is_code_match) {
+                break;
+            }
+
+            check_filters(history, reference, possible_answers, answer_table, answer_trie, filter_checks);
+            check_filters(history, reference, possible_guesses, guess_table, guess_trie, filter_checks);
+        }
+    }
+
+    std::cerr.rdbuf(cerr_buffer);
+    std::cerr.clear();
+}
+
+static void print_check(const KernelCheck& check) {
+    auto per_second = [&](double seconds) {
+        return seconds > 0 ? check.num_checked / seconds / 1e6 : 0.0;
+    };
+    std::cout << "   " << std::left << std::setw(28) << check.name << std::right
+        << " | " << std::setw(12) << check.num_checked << " " << std::left << std::setw(8) << check.unit
+        << std::right << " | " << std::setw(10) << check.num_mismatches
+        << " | " << std::fixed << std::setprecision(2) << std::setw(9) << per_second(check.reference_seconds)
+        << " | " << std::setw(9) << per_second(check.optimized_seconds)
+        << " | " << std::setw(6) << (
+            check.optimized_seconds > 0 ? check.reference_seconds / check.optimized_seconds : 0.0
+        ) << "x |\n";
+    std::cout.unsetf(std::ios::fixed);
+}
+
+int run_verification(
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers,
+    uint32_t num_random_games,
+    uint32_t seed
+) {
+    if (possible_guesses.empty() || possible_answers.empty()) {
+        std::cerr << "Nothing to verify with empty word lists" << std::endl;
+        return 1;
+    }
+
+    KernelCheck response_check("calculate_response_code", "pairs");
+    KernelCheck pair_update_check("try_update (every pair)", "pairs");
+    KernelCheck try_update_check("try_update (random games)", "updates");
+    KernelCheck code_update_check("update(code) (random games)", "updates");
+    KernelCheck table_check("WordTable filter", "words");
+    KernelCheck trie_check("WordTrie filter", "words");
+    FilterChecks filter_checks = {table_check, trie_check};
+
+    std::cout << "Verifying " << possible_guesses.size() << " guesses x " << possible_answers.size()
+        << " answers, and " << num_random_games << " random games (seed " << seed << ")" << std::endl;
+    check_all_pairs(possible_guesses, possible_answers, response_check, pair_update_check);
+    check_random_games(
+        possible_guesses,
+        possible_answers,
+        num_random_games,
+        seed,
+        try_update_check,
+        code_update_check,
+        filter_checks
+    );
+
+    std::cout << "\nVERIFY (millions per second of CPU time):\n"
+        << "   Kernel                       | Checked               | Mismatches | Reference | Optimized | Speedup |\n"
+        << "  ----------------------------------------------------------------------------------------------------------\n";
+    const std::vector<const KernelCheck*> checks = {
+        &response_check, &pair_update_check, &try_update_check, &code_update_check, &table_check, &trie_check
+    };
+    uint64_t num_mismatches = 0;
+    for (const auto* check : checks) {
+        print_check(*check);
+        num_mismatches += check->num_mismatches;
+    }
+
+    for (const auto* check : checks) {
+        if (check->first_mismatches.empty()) continue;
+        std::cout << "\nFirst mismatches in " << check->name << " (reference vs optimized):\n";
+        for (const auto& mismatch : check->first_mismatches) {
+            std::cout << "  " << mismatch << "\n";
+        }
+    }
+    std::cout << (num_mismatches ? "\nFAILED: " : "\nOK: ") << num_mismatches << " mismatches" << std::endl;
+    return num_mismatches ? 1 : 0;
+}
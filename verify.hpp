@@ -0,0 +1,27 @@
+#ifndef verify_hpp
+#define verify_hpp
+
+#include <vector>
+#include <stdint.h>
+
+#include "common.hpp"
+
+// --verify: runs each optimized kernel next to the straightforward version it
+// replaced and checks that they agree:
+//   calculate_response_code       vs response_to_index(calculate_response)
+//   try_update_from_word_guess    vs update_from_word_guess(ResponseArray)
+//   update_from_word_guess(code)  vs update_from_word_guess(ResponseArray)
+//   WordTable / WordTrie filters  vs is_word_allowed on every word
+// The first two over every guess x answer pair from an empty restriction, and
+// everything over random games of a few turns, some with made up (possibly
+// impossible) responses so that the error paths get compared too. Prints the
+// first few mismatches of each and how fast each side was. Returns what main
+// should: 0 if everything matched, 1 if not.
+int run_verification(
+    const std::vector<WordArray>& possible_guesses,
+    const std::vector<WordArray>& possible_answers,
+    uint32_t num_random_games,
+    uint32_t seed
+);
+
+#endif
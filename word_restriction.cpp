@@ -11,10 +11,16 @@
 
 #include "common.hpp"
 #include "word_restriction.hpp"
+#include "alphabet.hpp"
+#include "profiler.hpp"
+
+// _try_propagate_restrictions counts letter positions in 3 bits
+static_assert(WORD_LENGTH < 8, "Position counts have to fit in 3 bits");
 
 std::vector<int> WordRestriction::get_surviving_word_indexes(
     const std::vector<WordArray>& words
 ) const {
+    ProfileTimer timer(PROFILE_FILTER);
     std::vector<int> allowed_word_indexes;
 
     if (words.size() > std::numeric_limits<int>::max()) {
@@ -34,6 +40,7 @@ std::vector<int> WordRestriction::get_surviving_word_indexes(
 std::vector<WordArray> WordRestriction::get_surviving_words(
     const std::vector<WordArray>& words
 ) const {
+    ProfileTimer timer(PROFILE_FILTER);
     std::vector<WordArray> surviving_words;
 
     std::cout << "Initial Words Len: " << words.size() << std::endl;
@@ -93,10 +100,10 @@ bool WordRestriction::can_provide_new_information(
         letter_counts[word[index]]++;
     }
 
-    uint32_t seen_letters = 0;
+    LetterMask seen_letters = NO_LETTERS;
     for (uletter_int index = 0; index < WORD_LENGTH; index++) {
         uletter_int letter = word[index];
-        if (seen_letters & CHAR_FLAGS[letter]) {
+        if (has_letter(seen_letters, letter)) {
             continue;
         }
         seen_letters ^= CHAR_FLAGS[letter];
@@ -111,29 +118,31 @@ bool WordRestriction::can_provide_new_information(
 }
 
 void WordRestriction::print() const {
+    // Only the letters the word lists use
+    const Alphabet& alphabet = get_alphabet();
     std::cout << "Positional info:";
     for (uletter_int index = 0; index < WORD_LENGTH; index++) {
         std::cout << "\n  "<< (int) index <<":";
-        for (uletter_int letter = 0; letter < ALPHABET_LENGTH; letter++) {
+        for (uletter_int letter = 0; letter < alphabet.size(); letter++) {
             if (can_letter_be_at_index(letter, index)) {
-                std::cout << " " << (char) (letter + 'a');
+                std::cout << " " << alphabet.get_letter_string(letter);
             }
         }
     }
     std::cout << "\n\nCount Info:";
-    for (uletter_int letter = 0; letter < ALPHABET_LENGTH; letter++) {
-        std::cout << "\n  " << (char) (letter + 'a') << ": "
+    for (uletter_int letter = 0; letter < alphabet.size(); letter++) {
+        std::cout << "\n  " << alphabet.get_letter_string(letter) << ": "
             << (int) min_possible[letter] << " to " << (int) max_possible[letter];
     }
     std::cout << std::endl;
 }
 
 bool WordRestriction::can_letter_be_at_index(uletter_int letter, uletter_int index) const {
-    return pos_to_allowed[index] & CHAR_FLAGS[letter];
+    return has_letter(pos_to_allowed[index], letter);
 }
 
 uletter_int WordRestriction::num_possible_letters_at_loc(uletter_int index) const {
-    return std::popcount(pos_to_allowed[index]);
+    return count_letters(pos_to_allowed[index]);
 }
 
 // TOO LONG - break up into multiple functions probably.
@@ -169,9 +178,9 @@ void WordRestriction::update_from_word_guess(
 
     // Adjust min/max possible of each letter according to above counts.
     // AND removing gray letters from other locations, as possible
-    uint32_t seen_letters = 0;
+    LetterMask seen_letters = NO_LETTERS;
     for (uletter_int letter: guess) {
-        if (seen_letters & CHAR_FLAGS[letter]) {
+        if (has_letter(seen_letters, letter)) {
             continue;
         }
         seen_letters ^= CHAR_FLAGS[letter];  // xor is fine, only will do once per letter
@@ -200,7 +209,100 @@ void WordRestriction::update_from_word_guess(
         }
     }
 
+    _propagate_restrictions();
+}
+
+// What one response tells us about one letter of the guess, given which
+// positions of the guess that letter is in
+struct LetterDelta {
+    uletter_int min_count = 0;  // green + yellow copies of the letter
+    bool sets_max = false;      // a gray copy means min_count is also the max
+    uint8_t green_positions = 0;
+    uint8_t removed_positions = 0;
+};
+
+static constexpr uint8_t ALL_POSITIONS = (1 << WORD_LENGTH) - 1;
+
+// [letter positions][response code]. The letter positions are the only part of
+// the letter multiplicity pattern that matters: how many times it was submitted
+// is their popcount, and the response at those positions gives the rest.
+constexpr std::array<std::array<LetterDelta, NUM_RESPONSES>, 1 << WORD_LENGTH> make_letter_delta_table() {
+    std::array<std::array<LetterDelta, NUM_RESPONSES>, 1 << WORD_LENGTH> table = {};
+    for (uint8_t positions = 1; positions <= ALL_POSITIONS; positions++) {
+        for (std::size_t code = 0; code < NUM_RESPONSES; code++) {
+            const ResponseMasks& masks = RESPONSE_CODE_TO_MASKS[code];
+            LetterDelta& delta = table[positions][code];
+            uint8_t greens = positions & masks.green;
+            uint8_t yellows = positions & masks.yellow;
+            uint8_t grays = positions & masks.gray;
+
+            delta.min_count = std::popcount((unsigned) (greens | yellows));
+            delta.sets_max = grays != 0;
+            delta.green_positions = greens;
+            delta.removed_positions = yellows | grays;
+            // A gray copy and no yellows means we know where all of them are
+            if (grays && !yellows) {
+                delta.removed_positions |= ALL_POSITIONS & ~masks.green;
+            }
+        }
+    }
+    return table;
+}
+
+static constexpr auto LETTER_DELTA_TABLE = make_letter_delta_table();
 
+void WordRestriction::update_from_word_guess(
+    const WordArray& guess,
+    ResponseCode response_code
+){
+    ProfileTimer timer(PROFILE_RESTRICTION_UPDATE);
+    RestrictionStatus status = try_update_from_word_guess(guess, response_code);
+    if (status != RESTRICTION_OK) {
+        _throw_invalid_restriction(status);
+    }
+}
+
+RestrictionStatus WordRestriction::try_update_from_word_guess(
+    const WordArray& guess,
+    ResponseCode response_code
+) noexcept {
+    // Distinct letters of the guess and which positions each one is in
+    std::array<uletter_int, WORD_LENGTH> letters;
+    std::array<uint8_t, WORD_LENGTH> letter_positions = {};
+    uletter_int num_letters = 0;
+    for (uletter_int index = 0; index < WORD_LENGTH; index++) {
+        uletter_int letter_num = 0;
+        while (letter_num < num_letters && letters[letter_num] != guess[index]) {
+            letter_num++;
+        }
+        if (letter_num == num_letters) {
+            letters[num_letters++] = guess[index];
+        }
+        letter_positions[letter_num] |= 1 << index;
+    }
+
+    for (uletter_int letter_num = 0; letter_num < num_letters; letter_num++) {
+        const uletter_int letter = letters[letter_num];
+        const LetterDelta& delta = LETTER_DELTA_TABLE[letter_positions[letter_num]][response_code];
+
+        min_possible[letter] = std::max(min_possible[letter], delta.min_count);
+        if (delta.sets_max) {
+            max_possible[letter] = delta.min_count;
+        }
+        for (uint32_t remaining = delta.green_positions; remaining; remaining &= remaining - 1) {
+            _set_only_char_possibility(letter, std::countr_zero(remaining));
+        }
+        for (uint32_t remaining = delta.removed_positions; remaining; remaining &= remaining - 1) {
+            _remove_char_possibility(letter, std::countr_zero(remaining));
+        }
+    }
+
+    return _try_propagate_restrictions();
+}
+
+// Everything that follows from the current min/max counts and allowed letters,
+// whatever guess they came from
+void WordRestriction::_propagate_restrictions() {
     // If I know that a word as at least 2 os, then I know that it can't have more than
     // 3 of anything else. Make those adjustments
     uletter_int sum_of_mins = std::accumulate(min_possible.begin(), min_possible.end(), 0);
@@ -230,22 +332,14 @@ void WordRestriction::update_from_word_guess(
     }
 
     // Glean additional information from maxes
-    uletter_int num_possible_letters = 0;
-    uletter_int sum_of_maxes = 0;
-    static std::vector<uletter_int> possible_letters;
-    static std::vector<uletter_int> impossible_letters;
-    #pragma omp threadprivate(possible_letters)
-    #pragma omp threadprivate(impossible_letters)
-    possible_letters.clear();
-    impossible_letters.clear();
+    uint32_t sum_of_maxes = 0;  // up to 5 * ALPHABET_LENGTH, which can be past 255
+    LetterMask impossible_letters = NO_LETTERS;
 
     for (uletter_int letter = 0; letter < ALPHABET_LENGTH; letter++) {
         if (max_possible[letter] > 0) {
             sum_of_maxes += max_possible[letter];
-            num_possible_letters++;
-            possible_letters.push_back(letter);
         } else {
-            impossible_letters.push_back(letter);
+            impossible_letters |= CHAR_FLAGS[letter];
         }
     }
     if (sum_of_maxes < WORD_LENGTH) {
@@ -263,10 +357,8 @@ void WordRestriction::update_from_word_guess(
     }
 
     // Anything with max 0 should be removed from all positions
-    for (auto letter : impossible_letters) {
-        for (int index = 0; index < WORD_LENGTH; index++) {
-            _remove_char_possibility(letter, index);
-        }
+    for (auto& letter_flags : pos_to_allowed) {
+        letter_flags &= ~impossible_letters;
     }
 
     // Any letters that must be in exactly 1 place and are only possible
@@ -293,12 +385,12 @@ void WordRestriction::update_from_word_guess(
     if (std::any_of(
         pos_to_allowed.begin(),
         pos_to_allowed.end(),
-        [](uint32_t letter_flags) {return letter_flags == 0; }
+        [](const LetterMask& letter_flags) {return letter_flags == NO_LETTERS; }
     )) {
         std::string error_str = "ERROR: The following location(s) have no allowed letters:";
         bool found_one = false;
         for (uletter_int letter_index = 0; letter_index < WORD_LENGTH; letter_index++) {
-            if (!pos_to_allowed[letter_index]) {
+            if (pos_to_allowed[letter_index] == NO_LETTERS) {
                 if (found_one) error_str += ", ";
                 error_str += " ";
                 found_one = true;
@@ -310,6 +402,135 @@ void WordRestriction::update_from_word_guess(
     }
 }
 
+// Same deductions as _propagate_restrictions, in the same order, but with the
+// per-letter loops done on letter bitmasks and failures returned instead of thrown.
+RestrictionStatus WordRestriction::_try_propagate_restrictions() noexcept {
+    uint32_t sum_of_mins = 0;
+    for (auto min_count : min_possible) {
+        sum_of_mins += min_count;
+    }
+    if (sum_of_mins > WORD_LENGTH) {
+        return RESTRICTION_TOO_MANY_LETTERS;
+    }
+
+    // How many positions each letter is still allowed in, as a 3 bit number
+    // spread over three letter masks (bit i of places_bit0 is bit 0 of letter
+    // i's count, etc) - ie all the counters added up at once.
+    LetterMask places_bit0 = NO_LETTERS;
+    LetterMask places_bit1 = NO_LETTERS;
+    LetterMask places_bit2 = NO_LETTERS;
+    for (auto letter_flags : pos_to_allowed) {
+        LetterMask carry0 = places_bit0 & letter_flags;
+        places_bit0 ^= letter_flags;
+        LetterMask carry1 = places_bit1 & carry0;
+        places_bit1 ^= carry0;
+        places_bit2 |= carry1;
+    }
+
+    // _propagate_restrictions only tightens maxes once something has a min.
+    // Without one, both limits below are at least WORD_LENGTH, so do nothing.
+    const uletter_int spare_letters = sum_of_mins > 0 ? WORD_LENGTH - sum_of_mins : WORD_LENGTH;
+    const uletter_int no_loc_limit = sum_of_mins > 0 ? 0 : 0x7;  // 7 >= WORD_LENGTH, so no limit
+
+    uint32_t sum_of_maxes = 0;
+    LetterMask impossible_letters = NO_LETTERS;
+    LetterMask single_letters = NO_LETTERS;  // letters that must be there exactly once
+    for (uletter_int letter = 0; letter < ALPHABET_LENGTH; letter++) {
+        uletter_int max_from_loc_data = (
+            get_letter_bit(places_bit0, letter)
+            | (get_letter_bit(places_bit1, letter) << 1)
+            | (get_letter_bit(places_bit2, letter) << 2)
+            | no_loc_limit
+        );
+        uletter_int max_count = std::min(
+            max_possible[letter],
+            std::min((uletter_int) (spare_letters + min_possible[letter]), max_from_loc_data)
+        );
+        max_possible[letter] = max_count;
+        sum_of_maxes += max_count;
+        impossible_letters |= letter_flag_if(max_count == 0, letter);
+        single_letters |= letter_flag_if(max_count == 1 && min_possible[letter] == 1, letter);
+    }
+    if (sum_of_maxes < WORD_LENGTH) {
+        return RESTRICTION_TOO_FEW_LETTERS;
+    }
+
+    if (sum_of_maxes == WORD_LENGTH) {
+        min_possible = max_possible;
+        single_letters = NO_LETTERS;
+        for (uletter_int letter = 0; letter < ALPHABET_LENGTH; letter++) {
+            single_letters |= letter_flag_if(max_possible[letter] == 1, letter);
+        }
+    }
+
+    for (auto& letter_flags : pos_to_allowed) {
+        letter_flags &= ~impossible_letters;
+    }
+
+    // In letter order, since pinning one letter down can leave another with
+    // only one place
+    for (LetterMask remaining = single_letters; remaining != NO_LETTERS; remaining = without_lowest_letter(remaining)) {
+        const LetterMask letter_flag = get_lowest_letter_flag(remaining);
+        uint32_t num_places = 0;
+        uletter_int only_index = 0;
+        for (uletter_int letter_index = 0; letter_index < WORD_LENGTH; letter_index++) {
+            if ((pos_to_allowed[letter_index] & letter_flag) != NO_LETTERS) {
+                num_places++;
+                only_index = letter_index;
+            }
+        }
+        if (num_places == 1) {
+            pos_to_allowed[only_index] = letter_flag;
+        }
+    }
+
+    uint32_t has_empty_position = 0;
+    for (auto letter_flags : pos_to_allowed) {
+        has_empty_position |= letter_flags == NO_LETTERS;
+    }
+    return has_empty_position ? RESTRICTION_EMPTY_POSITION : RESTRICTION_OK;
+}
+
+// The same errors _propagate_restrictions throws, worked out from where
+// _try_propagate_restrictions stopped
+void WordRestriction::_throw_invalid_restriction(RestrictionStatus status) const {
+    switch (status) {
+        case RESTRICTION_TOO_MANY_LETTERS: {
+            std::string error_msg = (
+                std::string("ERROR: Sum of minimum counts of letters is ")
+                + std::to_string(std::accumulate(min_possible.begin(), min_possible.end(), 0))
+                + " which is greater than word length of "
+                + std::to_string(WORD_LENGTH)
+            );
+            std::cerr << error_msg << std::endl;
+            throw InvalidRestriction(error_msg);
+        }
+        case RESTRICTION_TOO_FEW_LETTERS:
+            throw InvalidRestriction(
+                std::string("ERROR: Sum of maximum counts of letters is ")
+                + std::to_string(std::accumulate(max_possible.begin(), max_possible.end(), 0))
+                + " which is less than word length of "
+                + std::to_string(WORD_LENGTH)
+            );
+        case RESTRICTION_EMPTY_POSITION: {
+            std::string error_str = "ERROR: The following location(s) have no allowed letters:";
+            bool found_one = false;
+            for (uletter_int letter_index = 0; letter_index < WORD_LENGTH; letter_index++) {
+                if (pos_to_allowed[letter_index] == NO_LETTERS) {
+                    if (found_one) error_str += ", ";
+                    error_str += " ";
+                    found_one = true;
+                    error_str += std::to_string(letter_index);
+                }
+            }
+            error_str += ".\n";
+            throw InvalidRestriction(error_str);
+        }
+        case RESTRICTION_OK:
+            break;
+    }
+}
+
 void WordRestriction::_remove_char_possibility(
     uletter_int to_remove,
     uletter_int index
@@ -6,40 +6,10 @@
 #include <string>
 #include <stdint.h>
 
+#include "response_code.hpp"
+#include "letter_mask.hpp"
 #include "common.hpp"
 
-// binary number with 1 in bits 0-2WORD_LENGTH, inclusive
-static const uint32_t ANY_CHAR = 0x3ffffff;
-
-constexpr std::array<uint32_t, ALPHABET_LENGTH> CHAR_FLAGS = {
-    0x1,
-    0x2,
-    0x4,
-    0x8,
-    0x10,
-    0x20,
-    0x40,
-    0x80,
-    0x100,
-    0x200,
-    0x400,
-    0x800,
-    0x1000,
-    0x2000,
-    0x4000,
-    0x8000,
-    0x10000,
-    0x20000,
-    0x40000,
-    0x80000,
-    0x100000,
-    0x200000,
-    0x400000,
-    0x800000,
-    0x1000000,
-    0x2000000
-};
-
 class InvalidRestriction: public std::exception {
 private:
     const char* message;
@@ -53,19 +23,49 @@ public:
     }
 };
 
+// What try_update_from_word_guess found, instead of throwing InvalidRestriction.
+// Anything but RESTRICTION_OK means no word can satisfy the restriction (and the
+// restriction is left half updated, so should be thrown away).
+enum RestrictionStatus : uint8_t {
+    RESTRICTION_OK,
+    RESTRICTION_TOO_MANY_LETTERS,  // mins add up to more than WORD_LENGTH
+    RESTRICTION_TOO_FEW_LETTERS,   // maxes add up to less than WORD_LENGTH
+    RESTRICTION_EMPTY_POSITION     // some position has no letters left
+};
+
+constexpr std::array<LetterMask, WORD_LENGTH> make_any_char_array() {
+    std::array<LetterMask, WORD_LENGTH> any_char_array = {};
+    for (auto& letter_flags : any_char_array) {
+        letter_flags = ANY_CHAR;
+    }
+    return any_char_array;
+}
+
 class WordRestriction {
 public:
     AlphabetArray min_possible = EMPTY_ALPHABET_ARRAY;
     AlphabetArray max_possible = WORD_LEN_ALPHABET_ARRAY;
-    std::array<uint32_t, WORD_LENGTH> pos_to_allowed = {  // Ugh - this is gross initialization
-        ANY_CHAR, ANY_CHAR, ANY_CHAR, ANY_CHAR, ANY_CHAR
-    };
+    std::array<LetterMask, WORD_LENGTH> pos_to_allowed = make_any_char_array();
 
 
     void update_from_word_guess(
         const WordArray& guess,
         const ResponseArray& response
     );
+    // Same result as above, but each letter of guess is applied as one lookup in
+    // a table built at compile time (see word_restriction.cpp). The ResponseArray
+    // version is kept as the straightforward reference.
+    void update_from_word_guess(
+        const WordArray& guess,
+        ResponseCode response_code
+    );
+    // For the hot loops: doesn't allocate, throw, or profile, just reports
+    // whether the result is still possible. Keep the throwing versions for
+    // responses typed in by the user, where the error message matters.
+    RestrictionStatus try_update_from_word_guess(
+        const WordArray& guess,
+        ResponseCode response_code
+    ) noexcept;
 
     bool can_provide_new_information(const WordArray& word) const;
     bool can_letter_be_at_index(uletter_int letter, uletter_int index) const;
@@ -82,6 +82,9 @@ public:
     void print() const;
 
 private:
+    void _propagate_restrictions();
+    RestrictionStatus _try_propagate_restrictions() noexcept;
+    void _throw_invalid_restriction(RestrictionStatus status) const;
     void _remove_char_possibility(uletter_int to_remove, uletter_int index);
     void _set_only_char_possibility(uletter_int to_set, uletter_int index);
 };
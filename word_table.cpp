@@ -0,0 +1,252 @@
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <numeric>
+#include <bit>
+#include <limits>
+#include <stdexcept>
+#include <stdint.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "word_table.hpp"
+#include "word_restriction.hpp"
+#include "profiler.hpp"
+#include "common.hpp"
+
+// Counts (and min/max) are at most WORD_LENGTH, so the top bit of each nibble is
+// free to catch borrows when comparing all the nibbles at once.
+static_assert(WORD_LENGTH < 8, "Letter counts have to fit in 3 bits");
+
+static constexpr uint64_t NIBBLE_HIGH_BITS = 0x8888888888888888;
+
+// Below this many blocks, starting threads costs more than it saves
+static constexpr int64_t MIN_PARALLEL_BLOCKS = 256;
+
+// True if every nibble of a is >= the same nibble of b. With the high bit of
+// each of a's nibbles set, subtracting can't borrow out of a nibble, and the
+// high bit only gets cleared if that nibble of b was bigger.
+static inline bool nibbles_are_at_least(uint64_t a, uint64_t b) {
+    return (((a | NIBBLE_HIGH_BITS) - b) & NIBBLE_HIGH_BITS) == NIBBLE_HIGH_BITS;
+}
+
+static inline bool counts_are_at_least(
+    const WordTable::PackedCounts& a,
+    const WordTable::PackedCounts& b
+) {
+    for (std::size_t group = 0; group < WordTable::NUM_LETTER_GROUPS; group++) {
+        if (!nibbles_are_at_least(a[group], b[group])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static WordTable::PackedCounts pack_counts(const AlphabetArray& letter_counts) {
+    WordTable::PackedCounts packed = {};
+    for (uletter_int letter = 0; letter < ALPHABET_LENGTH; letter++) {
+        packed[letter / 16] |= (uint64_t) letter_counts[letter] << (4 * (letter % 16));
+    }
+    return packed;
+}
+
+WordTable::WordTable(const std::vector<WordArray>& words) : words(words) {
+    if (words.size() > std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error("ERROR: Number of words can't be stored in a uint32_t");
+    }
+    std::size_t padded_size = (words.size() + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+    for (auto& letters : position_to_letters) {
+        letters.resize(padded_size, 0);
+    }
+    letter_counts.resize(words.size());
+
+    for (std::size_t word_index = 0; word_index < words.size(); word_index++) {
+        AlphabetArray word_letter_counts = EMPTY_ALPHABET_ARRAY;
+        for (uletter_int index = 0; index < WORD_LENGTH; index++) {
+            position_to_letters[index][word_index] = words[word_index][index];
+            word_letter_counts[words[word_index][index]]++;
+        }
+        letter_counts[word_index] = pack_counts(word_letter_counts);
+    }
+}
+
+std::size_t WordTable::size() const {
+    return words.size();
+}
+
+const WordArray& WordTable::get_word(std::size_t index) const {
+    return words[index];
+}
+
+#if defined(__AVX2__)
+// 0xff for each letter allowed at a position, as one 16 byte lookup table per
+// group of 16 letters, the way _mm256_shuffle_epi8 wants them (each repeated
+// in both lanes).
+struct AllowedTable {
+    __m256i groups[WordTable::NUM_LETTER_GROUPS];
+};
+
+static AllowedTable get_allowed_table(const LetterMask& allowed_mask) {
+    alignas(32) std::array<std::array<uint8_t, 32>, WordTable::NUM_LETTER_GROUPS> bytes = {};
+    for (uletter_int letter = 0; letter < ALPHABET_LENGTH; letter++) {
+        const uint8_t is_allowed = has_letter(allowed_mask, letter) ? 0xff : 0;
+        bytes[letter / 16][letter % 16] = bytes[letter / 16][letter % 16 + 16] = is_allowed;
+    }
+    AllowedTable table;
+    for (std::size_t group = 0; group < WordTable::NUM_LETTER_GROUPS; group++) {
+        table.groups[group] = _mm256_load_si256(reinterpret_cast<const __m256i*>(bytes[group].data()));
+    }
+    return table;
+}
+
+// 0xff for each of letters allowed by table
+static inline __m256i get_allowed_letters(const AllowedTable& table, __m256i letters) {
+    if constexpr (WordTable::NUM_LETTER_GROUPS == 1) {
+        return _mm256_shuffle_epi8(table.groups[0], letters);
+    } else if constexpr (WordTable::NUM_LETTER_GROUPS == 2) {
+        // shuffle_epi8 only looks at the low 4 bits, so look the letter up in
+        // both halves and pick by bit 4 (moved up to bit 7, which blendv uses)
+        __m256i from_low = _mm256_shuffle_epi8(table.groups[0], letters);
+        __m256i from_high = _mm256_shuffle_epi8(table.groups[1], letters);
+        return _mm256_blendv_epi8(from_low, from_high, _mm256_slli_epi16(letters, 3));
+    } else {
+        // Same idea, but the group each letter is in has to be compared for
+        const __m256i letter_groups = _mm256_and_si256(
+            _mm256_srli_epi16(letters, 4),
+            _mm256_set1_epi8(0x0f)
+        );
+        __m256i is_allowed = _mm256_setzero_si256();
+        for (std::size_t group = 0; group < WordTable::NUM_LETTER_GROUPS; group++) {
+            __m256i in_group = _mm256_cmpeq_epi8(letter_groups, _mm256_set1_epi8((char) group));
+            is_allowed = _mm256_or_si256(
+                is_allowed,
+                _mm256_and_si256(in_group, _mm256_shuffle_epi8(table.groups[group], letters))
+            );
+        }
+        return is_allowed;
+    }
+}
+#endif
+
+void WordTable::get_surviving_indexes(
+    const WordRestriction& restriction,
+    std::vector<uint32_t>& surviving_indexes
+) const {
+    ProfileTimer timer(PROFILE_FILTER);
+    surviving_indexes.clear();
+
+    const PackedCounts min_counts = pack_counts(restriction.min_possible);
+    const PackedCounts max_counts = pack_counts(restriction.max_possible);
+
+#if defined(__AVX2__)
+    std::array<AllowedTable, WORD_LENGTH> position_to_table;
+    for (uletter_int index = 0; index < WORD_LENGTH; index++) {
+        position_to_table[index] = get_allowed_table(restriction.pos_to_allowed[index]);
+    }
+#endif
+
+    const int64_t num_blocks = (words.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    std::vector<uint32_t> block_to_mask(num_blocks);
+
+    // block_index is signed to make omp happy
+    #pragma omp parallel for if (num_blocks >= MIN_PARALLEL_BLOCKS)
+    for (int64_t block_index = 0; block_index < num_blocks; block_index++) {
+        const std::size_t block_begin = block_index * BLOCK_SIZE;
+
+        // Bit i set if word block_begin + i has an allowed letter in every position
+#if defined(__AVX2__)
+        __m256i is_allowed = _mm256_set1_epi8(-1);
+        for (uletter_int index = 0; index < WORD_LENGTH; index++) {
+            __m256i letters = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(position_to_letters[index].data() + block_begin)
+            );
+            is_allowed = _mm256_and_si256(
+                is_allowed,
+                get_allowed_letters(position_to_table[index], letters)
+            );
+        }
+        uint32_t mask = (uint32_t) _mm256_movemask_epi8(is_allowed);
+#else
+        uint32_t mask = 0xffffffff;
+        for (uletter_int index = 0; index < WORD_LENGTH; index++) {
+            const LetterMask& allowed = restriction.pos_to_allowed[index];
+            const uletter_int* letters = position_to_letters[index].data() + block_begin;
+            uint32_t is_allowed_here = 0;
+            for (std::size_t offset = 0; offset < BLOCK_SIZE; offset++) {
+                is_allowed_here |= (uint32_t) get_letter_bit(allowed, letters[offset]) << offset;
+            }
+            mask &= is_allowed_here;
+        }
+#endif
+
+        // Padding at the end of the last block
+        std::size_t num_in_block = std::min(BLOCK_SIZE, words.size() - block_begin);
+        if (num_in_block < BLOCK_SIZE) {
+            mask &= (1u << num_in_block) - 1;
+        }
+
+        // Counts only need checking for the (usually few) words that got this far
+        for (uint32_t remaining = mask; remaining; remaining &= remaining - 1) {
+            std::size_t word_index = block_begin + std::countr_zero(remaining);
+            if (
+                !counts_are_at_least(letter_counts[word_index], min_counts)
+                || !counts_are_at_least(max_counts, letter_counts[word_index])
+            ) {
+                mask &= ~(1u << std::countr_zero(remaining));
+            }
+        }
+        block_to_mask[block_index] = mask;
+    }
+
+    for (int64_t block_index = 0; block_index < num_blocks; block_index++) {
+        for (uint32_t mask = block_to_mask[block_index]; mask; mask &= mask - 1) {
+            surviving_indexes.push_back(block_index * BLOCK_SIZE + std::countr_zero(mask));
+        }
+    }
+}
+
+void WordTable::narrow_surviving_indexes(
+    const WordRestriction& restriction,
+    std::vector<uint32_t>& surviving_indexes
+) const {
+    // Nothing narrowed yet, so the block at a time version is quicker
+    if (surviving_indexes.size() == words.size()) {
+        get_surviving_indexes(restriction, surviving_indexes);
+        return;
+    }
+    ProfileTimer timer(PROFILE_FILTER);
+
+    const PackedCounts min_counts = pack_counts(restriction.min_possible);
+    const PackedCounts max_counts = pack_counts(restriction.max_possible);
+
+    std::size_t num_kept = 0;
+    for (auto word_index : surviving_indexes) {
+        bool is_allowed = (
+            counts_are_at_least(letter_counts[word_index], min_counts)
+            && counts_are_at_least(max_counts, letter_counts[word_index])
+        );
+        for (uletter_int index = 0; index < WORD_LENGTH; index++) {
+            is_allowed &= has_letter(restriction.pos_to_allowed[index], position_to_letters[index][word_index]);
+        }
+        surviving_indexes[num_kept] = word_index;
+        num_kept += is_allowed;
+    }
+    surviving_indexes.resize(num_kept);
+}
+
+void WordTable::get_all_indexes(std::vector<uint32_t>& indexes_dest) const {
+    indexes_dest.resize(words.size());
+    std::iota(indexes_dest.begin(), indexes_dest.end(), 0);
+}
+
+void WordTable::get_words(
+    const std::vector<uint32_t>& indexes,
+    std::vector<WordArray>& words_dest
+) const {
+    words_dest.resize(indexes.size());
+    for (std::size_t index = 0; index < indexes.size(); index++) {
+        words_dest[index] = words[indexes[index]];
+    }
+}
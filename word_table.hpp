@@ -0,0 +1,65 @@
+#ifndef word_table_hpp
+#define word_table_hpp
+
+#include <vector>
+#include <array>
+#include <stdint.h>
+
+#include "word_restriction.hpp"
+#include "common.hpp"
+
+// The same words as a std::vector<WordArray>, laid out for checking a whole
+// list against a restriction at once: one column of letters per position (so
+// 32 words' letters at a position are one AVX2 load), and each word's letter
+// counts packed into 4 bit nibbles (so min/max counts are a couple of integer
+// ops instead of a 26 entry loop). Built once per word list.
+class WordTable {
+public:
+    // Words are filtered in blocks of this many
+    static constexpr std::size_t BLOCK_SIZE = 32;
+
+    // Nibble i of word g is the count of letter 16g + i
+    static constexpr std::size_t NUM_LETTER_GROUPS = (ALPHABET_LENGTH + 15) / 16;
+    typedef std::array<uint64_t, NUM_LETTER_GROUPS> PackedCounts;
+
+    WordTable() = default;
+    explicit WordTable(const std::vector<WordArray>& words);
+
+    std::size_t size() const;
+    const WordArray& get_word(std::size_t index) const;
+
+    // Indexes of every word that restriction allows, in order - the same words
+    // that restriction.is_word_allowed would keep. Written over
+    // surviving_indexes, which keeps its capacity, so reusing the same vector
+    // turn after turn doesn't reallocate.
+    void get_surviving_indexes(
+        const WordRestriction& restriction,
+        std::vector<uint32_t>& surviving_indexes
+    ) const;
+
+    // Keeps only the surviving_indexes that restriction allows. Hints only ever
+    // narrow things down, so last turn's survivors are all that need checking
+    // against this turn's restriction. Starting from get_all_indexes, this is
+    // get_surviving_indexes.
+    void narrow_surviving_indexes(
+        const WordRestriction& restriction,
+        std::vector<uint32_t>& surviving_indexes
+    ) const;
+
+    // Overwrites indexes_dest with every index, 0 to size() - 1
+    void get_all_indexes(std::vector<uint32_t>& indexes_dest) const;
+
+    // Overwrites words_dest with the words at indexes, reusing its storage
+    void get_words(
+        const std::vector<uint32_t>& indexes,
+        std::vector<WordArray>& words_dest
+    ) const;
+
+private:
+    std::vector<WordArray> words;
+    // Padded to a whole number of blocks
+    std::array<std::vector<uletter_int>, WORD_LENGTH> position_to_letters;
+    std::vector<PackedCounts> letter_counts;
+};
+
+#endif
@@ -0,0 +1,215 @@
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <stdexcept>
+#include <stdint.h>
+
+#include "word_trie.hpp"
+#include "word_restriction.hpp"
+#include "profiler.hpp"
+#include "common.hpp"
+
+// Node 0 is the end of every word
+static constexpr uint32_t END_NODE = 0;
+
+WordTrie::WordTrie(const std::vector<WordArray>& words) {
+    std::vector<WordArray> sorted_words = words;
+    std::sort(sorted_words.begin(), sorted_words.end());
+    sorted_words.erase(std::unique(sorted_words.begin(), sorted_words.end()), sorted_words.end());
+    if (sorted_words.size() > std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error("ERROR: Number of words can't be stored in a uint32_t");
+    }
+
+    Node end_node;
+    end_node.num_words = 1;
+    nodes.push_back(end_node);
+
+    std::map<std::vector<uint64_t>, uint32_t> edges_to_node;
+    root = _build(sorted_words, 0, sorted_words.size(), 0, edges_to_node);
+}
+
+// Builds the subtree for sorted_words[begin, end), which all share their first
+// depth letters, and returns its node. Built bottom up, so a node is only added
+// if no node with exactly the same edges exists yet - which is what merges
+// identical subtrees.
+uint32_t WordTrie::_build(
+    const std::vector<WordArray>& sorted_words,
+    std::size_t begin,
+    std::size_t end,
+    uletter_int depth,
+    std::map<std::vector<uint64_t>, uint32_t>& edges_to_node
+) {
+    if (depth == WORD_LENGTH) {
+        return END_NODE;
+    }
+
+    std::vector<Edge> node_edges;
+    std::vector<uint64_t> signature;
+    for (std::size_t run_begin = begin; run_begin < end;) {
+        uletter_int letter = sorted_words[run_begin][depth];
+        std::size_t run_end = run_begin;
+        while (run_end < end && sorted_words[run_end][depth] == letter) {
+            run_end++;
+        }
+        uint32_t child = _build(sorted_words, run_begin, run_end, depth + 1, edges_to_node);
+        node_edges.push_back({letter, child});
+        signature.push_back(((uint64_t) letter << 32) | child);
+        run_begin = run_end;
+    }
+
+    auto found = edges_to_node.find(signature);
+    if (found != edges_to_node.end()) {
+        return found->second;
+    }
+
+    Node node;
+    node.first_edge = edges.size();
+    node.num_edges = node_edges.size();
+    for (const auto& edge : node_edges) {
+        node.letters_below |= CHAR_FLAGS[edge.letter] | nodes[edge.child].letters_below;
+        node.num_words += nodes[edge.child].num_words;
+        edges.push_back(edge);
+    }
+    nodes.push_back(node);
+    edges_to_node.emplace(std::move(signature), nodes.size() - 1);
+    return nodes.size() - 1;
+}
+
+std::size_t WordTrie::size() const {
+    return nodes.empty() ? 0 : nodes[root].num_words;
+}
+
+std::size_t WordTrie::get_num_nodes() const {
+    return nodes.size();
+}
+
+// True if every word below node_index is allowed, given what's been picked so
+// far: nothing is still missing, and no letter below could be in a disallowed
+// position or go over its max even if it filled every remaining position.
+bool WordTrie::_is_whole_subtree_allowed(
+    uint32_t node_index,
+    uletter_int depth,
+    const WalkState& state
+) const {
+    const LetterMask letters_below = nodes[node_index].letters_below;
+    if (
+        state.missing_letters != NO_LETTERS
+        || (letters_below & state.allowed_from[depth]) != letters_below
+    ) {
+        return false;
+    }
+    const uletter_int num_remaining = WORD_LENGTH - depth;
+    for (LetterMask remaining = letters_below; remaining != NO_LETTERS; remaining = without_lowest_letter(remaining)) {
+        uletter_int letter = get_lowest_letter(remaining);
+        if (state.letter_counts[letter] + num_remaining > state.restriction.max_possible[letter]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::size_t WordTrie::_walk(uint32_t node_index, uletter_int depth, WalkState& state) const {
+    if (depth == WORD_LENGTH) {
+        if (state.words_dest != nullptr) {
+            state.words_dest->push_back(state.word);
+        }
+        return 1;
+    }
+    if (state.words_dest == nullptr && _is_whole_subtree_allowed(node_index, depth, state)) {
+        return nodes[node_index].num_words;
+    }
+
+    const WordRestriction& restriction = state.restriction;
+    const uletter_int num_remaining_after = WORD_LENGTH - depth - 1;
+    const Node& node = nodes[node_index];
+    std::size_t num_matches = 0;
+    for (uint32_t edge_index = node.first_edge; edge_index < node.first_edge + node.num_edges; edge_index++) {
+        const Edge& edge = edges[edge_index];
+        const uletter_int letter = edge.letter;
+        if (
+            !has_letter(restriction.pos_to_allowed[depth], letter)
+            || state.letter_counts[letter] >= restriction.max_possible[letter]
+        ) {
+            continue;
+        }
+
+        bool fills_missing = state.letter_counts[letter] < restriction.min_possible[letter];
+        uint32_t num_missing_after = state.num_missing - fills_missing;
+        LetterMask missing_letters_after = state.missing_letters;
+        if (state.letter_counts[letter] + 1 == restriction.min_possible[letter]) {
+            missing_letters_after &= ~CHAR_FLAGS[letter];
+        }
+        // Not enough room left for the letters that are still needed, or they
+        // just don't appear anywhere below
+        if (
+            num_missing_after > num_remaining_after
+            || (nodes[edge.child].letters_below & missing_letters_after) != missing_letters_after
+        ) {
+            continue;
+        }
+
+        const LetterMask missing_letters_before = state.missing_letters;
+        const uint32_t num_missing_before = state.num_missing;
+        state.letter_counts[letter]++;
+        state.missing_letters = missing_letters_after;
+        state.num_missing = num_missing_after;
+        state.word[depth] = letter;
+
+        num_matches += _walk(edge.child, depth + 1, state);
+
+        state.letter_counts[letter]--;
+        state.missing_letters = missing_letters_before;
+        state.num_missing = num_missing_before;
+    }
+    return num_matches;
+}
+
+WordTrie::WalkState::WalkState(
+    const WordRestriction& restriction,
+    std::vector<WordArray>* words_dest
+) :
+    restriction(restriction),
+    words_dest(words_dest)
+{
+    allowed_from[WORD_LENGTH] = ANY_CHAR;
+    for (int index = WORD_LENGTH - 1; index >= 0; index--) {
+        allowed_from[index] = allowed_from[index + 1] & restriction.pos_to_allowed[index];
+    }
+    for (uletter_int letter = 0; letter < ALPHABET_LENGTH; letter++) {
+        if (restriction.min_possible[letter]) {
+            missing_letters |= CHAR_FLAGS[letter];
+            num_missing += restriction.min_possible[letter];
+        }
+    }
+}
+
+std::size_t WordTrie::_match(
+    const WordRestriction& restriction,
+    std::vector<WordArray>* words_dest
+) const {
+    ProfileTimer timer(PROFILE_FILTER);
+    if (nodes.empty() || size() == 0) {
+        return 0;
+    }
+
+    WalkState state(restriction, words_dest);
+    if (
+        state.num_missing > WORD_LENGTH
+        || (nodes[root].letters_below & state.missing_letters) != state.missing_letters
+    ) {
+        return 0;
+    }
+    return _walk(root, 0, state);
+}
+
+std::vector<WordArray> WordTrie::get_matching_words(const WordRestriction& restriction) const {
+    std::vector<WordArray> matching_words;
+    _match(restriction, &matching_words);
+    return matching_words;
+}
+
+std::size_t WordTrie::count_matching_words(const WordRestriction& restriction) const {
+    return _match(restriction, nullptr);
+}
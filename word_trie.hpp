@@ -0,0 +1,76 @@
+#ifndef word_trie_hpp
+#define word_trie_hpp
+
+#include <vector>
+#include <map>
+#include <stdint.h>
+
+#include "word_restriction.hpp"
+#include "common.hpp"
+
+// A word list stored as a DAWG (a trie with identical subtrees merged, so shared
+// suffixes are stored once as well as shared prefixes). Matching a restriction
+// walks it depth first and drops a whole subtree as soon as its first letter
+// isn't allowed at that position, would go over max_possible, or can't leave
+// room for the letters min_possible still needs - instead of testing every word
+// separately. Meant for big dictionaries (eg words_lenN_370105.txt).
+class WordTrie {
+public:
+    WordTrie() = default;
+    explicit WordTrie(const std::vector<WordArray>& words);
+
+    std::size_t size() const;
+    std::size_t get_num_nodes() const;
+
+    // Every word that restriction allows, in alphabetical order
+    std::vector<WordArray> get_matching_words(const WordRestriction& restriction) const;
+
+    // How many words restriction allows, without building the list. Subtrees
+    // that restriction can't rule anything out of are counted without walking them.
+    std::size_t count_matching_words(const WordRestriction& restriction) const;
+
+private:
+    struct Edge {
+        uletter_int letter;
+        uint32_t child;
+    };
+
+    struct Node {
+        uint32_t first_edge = 0;
+        uint32_t num_edges = 0;
+        LetterMask letters_below = NO_LETTERS;  // CHAR_FLAGS of every letter in the subtree
+        uint32_t num_words = 0;                 // words in the subtree
+    };
+
+    // What's been picked on the way down to the current node
+    struct WalkState {
+        // At the root, before anything's been picked
+        WalkState(const WordRestriction& restriction, std::vector<WordArray>* words_dest);
+
+        const WordRestriction& restriction;
+        // allowed_from[i] is every letter allowed in all of positions i and on
+        std::array<LetterMask, WORD_LENGTH + 1> allowed_from;
+        AlphabetArray letter_counts = EMPTY_ALPHABET_ARRAY;
+        LetterMask missing_letters = NO_LETTERS;  // letters still under min_possible
+        uint32_t num_missing = 0;                 // sum of how far under
+        WordArray word = {};
+        std::vector<WordArray>* words_dest;  // null if only counting
+    };
+
+    uint32_t _build(
+        const std::vector<WordArray>& sorted_words,
+        std::size_t begin,
+        std::size_t end,
+        uletter_int depth,
+        std::map<std::vector<uint64_t>, uint32_t>& edges_to_node
+    );
+    std::size_t _walk(uint32_t node_index, uletter_int depth, WalkState& state) const;
+    bool _is_whole_subtree_allowed(uint32_t node_index, uletter_int depth, const WalkState& state) const;
+    std::size_t _match(const WordRestriction& restriction, std::vector<WordArray>* words_dest) const;
+
+    std::vector<Node> nodes;
+    std::vector<Edge> edges;
+    uint32_t root = 0;
+};
+
+#endif